@@ -0,0 +1,111 @@
+//
+//  batch.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+//Environments handed to a worker at a time. Small enough to balance, large
+//enough that the shared counter isn't contended at low resolutions.
+#define ENV_GRAIN_SIZE 16
+
+struct StepJob {
+    struct EnvBatch* batch;
+    const int8_t* walkDirections;
+    const int8_t* turnDirections;
+};
+
+int createEnvBatch(struct EnvBatch* batch, const struct World* world, int numEnvs, int width, int height,
+                   float deltaTime, int numThreads) {
+    batch->world = world;
+    batch->numEnvs = numEnvs;
+    batch->width = width;
+    batch->height = height;
+    batch->deltaTime = deltaTime;
+    batch->columns = NULL;
+    batch->contexts = (struct RenderContext*) calloc((size_t)numEnvs, sizeof(struct RenderContext));
+    batch->observations = (uint32_t*) malloc(sizeof(uint32_t) * (size_t)numEnvs * width * height);
+    batch->pool = createThreadPool(numThreads);
+    if(!batch->contexts || !batch->observations || !batch->pool) {
+        destroyEnvBatch(batch);
+        return FALSE;
+    }
+    for(int i = 0; i < numEnvs; i++) {
+        uint32_t* observation = &batch->observations[(size_t)i * width * height];
+        if(!createRenderContext(&batch->contexts[i], world, width, height, observation, FALSE)) {
+            batch->numEnvs = i;
+            destroyEnvBatch(batch);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void destroyEnvBatch(struct EnvBatch* batch) {
+    if(batch->contexts) {
+        for(int i = 0; i < batch->numEnvs; i++) {
+            destroyRenderContext(&batch->contexts[i]);
+        }
+    }
+    destroyThreadPool(batch->pool);
+    free(batch->contexts);
+    free(batch->observations);
+    free(batch->columns);
+    batch->pool = NULL;
+    batch->columns = NULL;
+    batch->contexts = NULL;
+    batch->observations = NULL;
+}
+
+int enableBatchColumnInfo(struct EnvBatch* batch) {
+    if(!batch->columns) {
+        batch->columns = (struct ColumnInfo*) malloc(sizeof(struct ColumnInfo) * (size_t)batch->numEnvs * batch->width);
+        if(!batch->columns) {
+            return FALSE;
+        }
+    }
+    for(int i = 0; i < batch->numEnvs; i++) {
+        batch->contexts[i].columns = &batch->columns[(size_t)i * batch->width];
+    }
+    return TRUE;
+}
+
+void resetEnv(struct EnvBatch* batch, int env, float x, float y, float rotationAngle) {
+    struct WorldState* state = &batch->contexts[env].state;
+    memset(state, 0, sizeof(*state));
+    resetPlayer(&state->player, x, y, rotationAngle);
+}
+
+void snapshotEnvBatch(const struct EnvBatch* batch, struct WorldState* states) {
+    for(int i = 0; i < batch->numEnvs; i++) {
+        states[i] = batch->contexts[i].state;
+    }
+}
+
+void restoreEnvBatch(struct EnvBatch* batch, const struct WorldState* states) {
+    for(int i = 0; i < batch->numEnvs; i++) {
+        batch->contexts[i].state = states[i];
+    }
+}
+
+static void stepEnvRange(void* data, int begin, int end) {
+    struct StepJob* job = (struct StepJob*) data;
+    for(int i = begin; i < end; i++) {
+        struct RenderContext* context = &job->batch->contexts[i];
+        context->state.player.walkDirection = job->walkDirections[i];
+        context->state.player.turnDirection = job->turnDirections[i];
+        movePlayer(context, job->batch->deltaTime);
+        castAllRays(context);
+        generate3DProjection(context);
+    }
+}
+
+void stepEnvBatch(struct EnvBatch* batch, const int8_t* walkDirections, const int8_t* turnDirections) {
+    struct StepJob job = { batch, walkDirections, turnDirections };
+    parallelFor(batch->pool, batch->numEnvs, ENV_GRAIN_SIZE, stepEnvRange, &job);
+}
@@ -0,0 +1,53 @@
+//
+//  batch.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef batch_h
+#define batch_h
+
+#include <stdint.h>
+#include "engine.h"
+#include "threadpool.h"
+
+//N independent environments over one shared World, stepped together with a fixed
+//time step. Headless: nothing here touches SDL.
+struct EnvBatch {
+    const struct World* world;
+    int numEnvs;
+    int width;
+    int height;
+    float deltaTime;
+    struct RenderContext* contexts;
+    //numEnvs observations of height rows by width ARGB pixels, back to back.
+    //Each context renders straight into its slice, so there is no copy.
+    uint32_t* observations;
+    //numEnvs rows of width ColumnInfo, laid out like observations. NULL until
+    //enableBatchColumnInfo() is called.
+    struct ColumnInfo* columns;
+    struct ThreadPool* pool;
+};
+
+//numThreads <= 0 uses every online CPU. Selects the render kernels if nothing has yet.
+int createEnvBatch(struct EnvBatch* batch, const struct World* world, int numEnvs, int width, int height,
+                   float deltaTime, int numThreads);
+void destroyEnvBatch(struct EnvBatch* batch);
+
+//Makes every step also write depth, tile ID and face per column into batch->columns.
+int enableBatchColumnInfo(struct EnvBatch* batch);
+
+void resetEnv(struct EnvBatch* batch, int env, float x, float y, float rotationAngle);
+
+//Copy every environment's state out to, or back in from, numEnvs WorldStates, e.g. to
+//branch rollouts from one point. Observations are not saved; step again to redraw them.
+void snapshotEnvBatch(const struct EnvBatch* batch, struct WorldState* states);
+void restoreEnvBatch(struct EnvBatch* batch, const struct WorldState* states);
+
+//Applies walkDirections[i] and turnDirections[i] (-1, 0 or 1) to environment i, advances
+//every environment by deltaTime and renders all observations.
+void stepEnvBatch(struct EnvBatch* batch, const int8_t* walkDirections, const int8_t* turnDirections);
+
+#endif /* batch_h */
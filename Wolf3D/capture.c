@@ -0,0 +1,186 @@
+//
+//  capture.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/28/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "constants.h"
+#include "capture.h"
+
+#define CAPTURE_POOL_SIZE 8
+
+struct CapturedFrame {
+    uint32_t frameNumber;
+    uint32_t ticks;
+    uint32_t* pixels;
+};
+
+//Single-producer, single-consumer ring over a fixed pool of frame buffers. The render
+//loop only advances writeIndex and the writer thread only advances readIndex, so the
+//two never need a lock; the semaphore just wakes the writer when a frame is queued.
+static struct CapturedFrame pool[CAPTURE_POOL_SIZE];
+static SDL_atomic_t writeIndex;
+static SDL_atomic_t readIndex;
+static SDL_atomic_t isCapturing;
+static SDL_sem* framesQueued = NULL;
+static SDL_Thread* writerThread = NULL;
+
+static enum CaptureFormat captureFormat;
+static const char* capturePath;
+static FILE* rawFile = NULL;
+static int frameWidth;
+static int frameHeight;
+static uint32_t framesSubmitted = 0;
+static uint32_t framesDropped = 0;
+static uint32_t framesWritten = 0;
+static uint8_t* rowBuffer = NULL;
+
+static int writeRawFrame(const struct CapturedFrame* frame) {
+    uint32_t header[2] = { frame->frameNumber, frame->ticks };
+    size_t pixelCount = (size_t)frameWidth * frameHeight;
+    return fwrite(header, sizeof(header), 1, rawFile) == 1
+    && fwrite(frame->pixels, sizeof(uint32_t), pixelCount, rawFile) == pixelCount;
+}
+
+static int writePpmFrame(const struct CapturedFrame* frame) {
+    char fileName[1024];
+    snprintf(fileName, sizeof(fileName), "%s/frame_%06u.ppm", capturePath, frame->frameNumber);
+    FILE* file = fopen(fileName, "wb");
+    if(!file) {
+        return FALSE;
+    }
+    int ok = fprintf(file, "P6\n%d %d\n255\n", frameWidth, frameHeight) > 0;
+    for(int y = 0; ok && y < frameHeight; y++) {
+        const uint32_t* pixel = &frame->pixels[y * frameWidth];
+        for(int x = 0; x < frameWidth; x++) {
+            rowBuffer[x * 3 + 0] = (pixel[x] >> 16) & 0xff;
+            rowBuffer[x * 3 + 1] = (pixel[x] >> 8) & 0xff;
+            rowBuffer[x * 3 + 2] = pixel[x] & 0xff;
+        }
+        ok = fwrite(rowBuffer, 3, (size_t)frameWidth, file) == (size_t)frameWidth;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+static int writerMain(void* data) {
+    (void)data;
+    for(;;) {
+        int read = SDL_AtomicGet(&readIndex);
+        if(read == SDL_AtomicGet(&writeIndex)) {
+            if(!SDL_AtomicGet(&isCapturing)) {
+                break;
+            }
+            SDL_SemWaitTimeout(framesQueued, 100);
+            continue;
+        }
+        const struct CapturedFrame* frame = &pool[read % CAPTURE_POOL_SIZE];
+        int ok = captureFormat == CAPTURE_RAW ? writeRawFrame(frame) : writePpmFrame(frame);
+        if(!ok) {
+            fprintf(stderr, "Error writing captured frame %u \n", frame->frameNumber);
+        }
+        else {
+            framesWritten++;
+        }
+        //Only now hand the buffer back to the render loop.
+        SDL_AtomicSet(&readIndex, read + 1);
+    }
+    return 0;
+}
+
+int startFrameCapture(const char* path, enum CaptureFormat format, int width, int height) {
+    captureFormat = format;
+    capturePath = path;
+    frameWidth = width;
+    frameHeight = height;
+    framesSubmitted = framesDropped = framesWritten = 0;
+
+    if(format == CAPTURE_RAW) {
+        rawFile = fopen(path, "wb");
+        if(!rawFile) {
+            fprintf(stderr, "Error opening capture file %s \n", path);
+            return FALSE;
+        }
+        uint32_t header[4] = { 0x44335757, 1, (uint32_t)width, (uint32_t)height }; //"WW3D", version 1
+        if(fwrite(header, sizeof(header), 1, rawFile) != 1) {
+            fprintf(stderr, "Error writing capture file %s \n", path);
+            stopFrameCapture();
+            return FALSE;
+        }
+    }
+    else {
+        rowBuffer = (uint8_t*) malloc((size_t)width * 3);
+        if(!rowBuffer) {
+            fprintf(stderr, "Error allocating capture buffers \n");
+            stopFrameCapture();
+            return FALSE;
+        }
+    }
+
+    for(int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        pool[i].pixels = (uint32_t*) malloc(sizeof(uint32_t) * (size_t)width * height);
+        if(!pool[i].pixels) {
+            fprintf(stderr, "Error allocating capture buffers \n");
+            stopFrameCapture();
+            return FALSE;
+        }
+    }
+    SDL_AtomicSet(&writeIndex, 0);
+    SDL_AtomicSet(&readIndex, 0);
+    SDL_AtomicSet(&isCapturing, TRUE);
+    framesQueued = SDL_CreateSemaphore(0);
+    writerThread = framesQueued ? SDL_CreateThread(writerMain, "FrameCapture", NULL) : NULL;
+    if(!writerThread) {
+        fprintf(stderr, "Error starting capture thread: %s \n", SDL_GetError());
+        SDL_AtomicSet(&isCapturing, FALSE);
+        stopFrameCapture();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void captureFrame(const uint32_t* colorBuffer, uint32_t ticks) {
+    if(!SDL_AtomicGet(&isCapturing)) {
+        return;
+    }
+    uint32_t frameNumber = framesSubmitted++;
+    int write = SDL_AtomicGet(&writeIndex);
+    if(write - SDL_AtomicGet(&readIndex) >= CAPTURE_POOL_SIZE) {
+        framesDropped++;
+        return;
+    }
+    struct CapturedFrame* frame = &pool[write % CAPTURE_POOL_SIZE];
+    frame->frameNumber = frameNumber;
+    frame->ticks = ticks;
+    memcpy(frame->pixels, colorBuffer, sizeof(uint32_t) * (size_t)frameWidth * frameHeight);
+    SDL_AtomicSet(&writeIndex, write + 1);
+    SDL_SemPost(framesQueued);
+}
+
+void stopFrameCapture(void) {
+    SDL_AtomicSet(&isCapturing, FALSE);
+    if(writerThread) {
+        SDL_SemPost(framesQueued);
+        SDL_WaitThread(writerThread, NULL);
+        writerThread = NULL;
+        printf("Captured %u frames, wrote %u, dropped %u \n", framesSubmitted, framesWritten, framesDropped);
+    }
+    if(framesQueued) {
+        SDL_DestroySemaphore(framesQueued);
+        framesQueued = NULL;
+    }
+    if(rawFile) {
+        fclose(rawFile);
+        rawFile = NULL;
+    }
+    free(rowBuffer);
+    rowBuffer = NULL;
+    for(int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        free(pool[i].pixels);
+        pool[i].pixels = NULL;
+    }
+}
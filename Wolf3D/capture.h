@@ -0,0 +1,31 @@
+//
+//  capture.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/28/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef capture_h
+#define capture_h
+
+#include <stdint.h>
+
+enum CaptureFormat {
+    CAPTURE_RAW,    //One file, every frame appended as a header plus BGRA pixels
+    CAPTURE_PPM     //One binary PPM per frame, numbered
+};
+
+//Allocates the buffer pool and starts the writer thread. Returns FALSE, with nothing
+//left allocated, if the output can't be opened or written, memory runs out or the
+//thread can't be started.
+int startFrameCapture(const char* path, enum CaptureFormat format, int width, int height);
+
+//Copies the frame into a free pool buffer and hands it to the writer thread.
+//Never allocates or waits on I/O: if every buffer is still queued the frame is dropped.
+void captureFrame(const uint32_t* colorBuffer, uint32_t ticks);
+
+//Writes out the queued frames, stops the thread and reports written and dropped frames.
+void stopFrameCapture(void);
+
+#endif /* capture_h */
@@ -31,9 +31,22 @@
 
 #define NUM_RAYS WINDOW_WIDTH
 
+#define MAX_WALL_STRIP_HEIGHT (1 << 20)
+
 #define FPS 60
 #define FRAME_TIME_LENGTH (1000 / FPS)
 
 #define NUM_TEXTURES 8
 
+#define BATCH_OBSERVATION_WIDTH 64
+#define BATCH_OBSERVATION_HEIGHT 64
+
+#define CEILING_COLOR 0xff333333
+#define FLOOR_COLOR 0xff777777
+
+#define PALETTE_SIZE 256
+#define BLACK_INDEX 0
+#define CEILING_INDEX 1
+#define FLOOR_INDEX 2
+
 #endif /* constants_h */
@@ -0,0 +1,214 @@
+//
+//  demo.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/31/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demo.h"
+
+#define DEMO_MAGIC 0x44443357   //"W3DD"
+#define DEMO_VERSION 2
+//Ticks buffered before they are appended to the file: about a second at 60 fps.
+#define DEMO_FLUSH_TICKS 64
+//Input byte, then the time step as a little-endian uint16.
+#define DEMO_TICK_SIZE 3
+
+//On disk: this header, then one DEMO_TICK_SIZE record per tick. Ticks are appended
+//as they are recorded; numTicks is filled in when recording stops, and stays 0 in a
+//file whose recording never finished.
+struct DemoHeader {
+    uint32_t magic;
+    uint32_t version;
+    float startX;
+    float startY;
+    float startAngle;
+    uint32_t numTicks;
+};
+
+static FILE* recordFile = NULL;
+static struct DemoHeader recordHeader;
+static uint8_t recordBuffer[DEMO_FLUSH_TICKS * DEMO_TICK_SIZE];
+static int numBufferedTicks = 0;
+static int isRecordingBroken = FALSE;
+
+static void flushDemoTicks(void) {
+    if(numBufferedTicks > 0 && !isRecordingBroken) {
+        size_t size = (size_t)numBufferedTicks * DEMO_TICK_SIZE;
+        if(fwrite(recordBuffer, 1, size, recordFile) != size || fflush(recordFile) != 0) {
+            fprintf(stderr, "Error writing the demo, recording stopped \n");
+            isRecordingBroken = TRUE;
+        }
+    }
+    numBufferedTicks = 0;
+}
+
+int startDemoRecording(const char* path, const struct Player* player) {
+    recordFile = fopen(path, "wb");
+    if(!recordFile) {
+        fprintf(stderr, "Error opening demo file %s \n", path);
+        return FALSE;
+    }
+    recordHeader.magic = DEMO_MAGIC;
+    recordHeader.version = DEMO_VERSION;
+    recordHeader.startX = player->x;
+    recordHeader.startY = player->y;
+    recordHeader.startAngle = player->rotationAngle;
+    recordHeader.numTicks = 0;
+    numBufferedTicks = 0;
+    isRecordingBroken = FALSE;
+    if(fwrite(&recordHeader, sizeof(recordHeader), 1, recordFile) != 1 || fflush(recordFile) != 0) {
+        fprintf(stderr, "Error writing demo file %s \n", path);
+        fclose(recordFile);
+        recordFile = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void recordDemoTick(int walkDirection, int turnDirection, uint32_t deltaMs) {
+    if(!recordFile || isRecordingBroken) {
+        return;
+    }
+    uint16_t delta = (uint16_t)(deltaMs < UINT16_MAX ? deltaMs : UINT16_MAX);
+    uint8_t* record = &recordBuffer[numBufferedTicks * DEMO_TICK_SIZE];
+    record[0] = (uint8_t)((walkDirection + 1) | ((turnDirection + 1) << 2));
+    record[1] = (uint8_t)(delta & 0xff);
+    record[2] = (uint8_t)(delta >> 8);
+    recordHeader.numTicks++;
+    if(++numBufferedTicks == DEMO_FLUSH_TICKS) {
+        flushDemoTicks();
+    }
+}
+
+void stopDemoRecording(void) {
+    if(!recordFile) {
+        return;
+    }
+    flushDemoTicks();
+    int ok = !isRecordingBroken && fseek(recordFile, 0, SEEK_SET) == 0
+    && fwrite(&recordHeader, sizeof(recordHeader), 1, recordFile) == 1;
+    if(fclose(recordFile) != 0 || !ok) {
+        fprintf(stderr, "Error writing the demo \n");
+    }
+    else {
+        printf("Recorded %u demo ticks \n", recordHeader.numTicks);
+    }
+    recordFile = NULL;
+}
+
+int loadDemo(struct Demo* demo, const char* path) {
+    memset(demo, 0, sizeof(*demo));
+    FILE* file = fopen(path, "rb");
+    if(!file) {
+        fprintf(stderr, "Error opening demo file %s \n", path);
+        return FALSE;
+    }
+    struct DemoHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != DEMO_MAGIC || header.version != DEMO_VERSION) {
+        fprintf(stderr, "%s is not a demo file \n", path);
+        fclose(file);
+        return FALSE;
+    }
+    //Count the ticks actually on disk, so a recording cut short still plays back.
+    long start = ftell(file);
+    long end = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if(start < 0 || end < start || fseek(file, start, SEEK_SET) != 0) {
+        fprintf(stderr, "Error reading demo file %s \n", path);
+        fclose(file);
+        return FALSE;
+    }
+    size_t numTicks = (size_t)(end - start) / DEMO_TICK_SIZE;
+    if(header.numTicks == 0) {
+        fprintf(stderr, "Demo %s was not finished, playing the %zu ticks recorded \n", path, numTicks);
+    }
+    else if(numTicks < header.numTicks) {
+        fprintf(stderr, "Demo file %s is truncated \n", path);
+        fclose(file);
+        return FALSE;
+    }
+    else {
+        numTicks = header.numTicks;
+    }
+    uint8_t* records = (uint8_t*) malloc(DEMO_TICK_SIZE * (numTicks ? numTicks : 1));
+    demo->inputs = (uint8_t*) malloc(sizeof(uint8_t) * (numTicks ? numTicks : 1));
+    demo->deltas = (uint16_t*) malloc(sizeof(uint16_t) * (numTicks ? numTicks : 1));
+    int ok = records && demo->inputs && demo->deltas && fread(records, DEMO_TICK_SIZE, numTicks, file) == numTicks;
+    fclose(file);
+    if(!ok) {
+        fprintf(stderr, "Error reading demo file %s \n", path);
+        free(records);
+        freeDemo(demo);
+        return FALSE;
+    }
+    for(size_t i = 0; i < numTicks; i++) {
+        demo->inputs[i] = records[i * DEMO_TICK_SIZE];
+        demo->deltas[i] = (uint16_t)(records[i * DEMO_TICK_SIZE + 1] | (records[i * DEMO_TICK_SIZE + 2] << 8));
+    }
+    free(records);
+    demo->startX = header.startX;
+    demo->startY = header.startY;
+    demo->startAngle = header.startAngle;
+    demo->numTicks = (int)numTicks;
+    return TRUE;
+}
+
+void freeDemo(struct Demo* demo) {
+    free(demo->inputs);
+    free(demo->deltas);
+    demo->inputs = NULL;
+    demo->deltas = NULL;
+    demo->numTicks = 0;
+}
+
+void rewindDemo(struct Demo* demo, struct Player* player) {
+    resetPlayer(player, demo->startX, demo->startY, demo->startAngle);
+    demo->nextTick = 0;
+}
+
+int isDemoFinished(const struct Demo* demo) {
+    return demo->nextTick >= demo->numTicks;
+}
+
+uint32_t playDemoTick(struct Demo* demo, struct Player* player) {
+    uint8_t input = demo->inputs[demo->nextTick];
+    player->walkDirection = (input & 3) - 1;
+    player->turnDirection = ((input >> 2) & 3) - 1;
+    return demo->deltas[demo->nextTick++];
+}
+
+static int compareDescending(const void* a, const void* b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x < y) - (x > y);
+}
+
+static double meanOfSlowest(const double* sortedMs, int numFrames, int divisor) {
+    int count = numFrames / divisor > 0 ? numFrames / divisor : 1;
+    double total = 0;
+    for(int i = 0; i < count; i++) {
+        total += sortedMs[i];
+    }
+    return total / count;
+}
+
+void computeFrameStats(double* frameMs, int numFrames, struct FrameStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->numFrames = numFrames;
+    if(numFrames == 0) {
+        return;
+    }
+    double total = 0;
+    for(int i = 0; i < numFrames; i++) {
+        total += frameMs[i];
+    }
+    qsort(frameMs, (size_t)numFrames, sizeof(double), compareDescending);
+    stats->averageMs = total / numFrames;
+    stats->onePercentLowMs = meanOfSlowest(frameMs, numFrames, 100);
+    stats->pointOnePercentLowMs = meanOfSlowest(frameMs, numFrames, 1000);
+    stats->worstMs = frameMs[0];
+}
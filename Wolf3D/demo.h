@@ -0,0 +1,55 @@
+//
+//  demo.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/31/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef demo_h
+#define demo_h
+
+#include <stdint.h>
+#include "engine.h"
+
+//A recorded run: the starting pose plus, for every tick, the inputs held and the
+//time step used. Replaying the same ticks through movePlayer() reproduces the run.
+struct Demo {
+    float startX;
+    float startY;
+    float startAngle;
+    int numTicks;
+    uint8_t* inputs;    //Two bits each of walkDirection + 1 and turnDirection + 1
+    uint16_t* deltas;   //Milliseconds
+    int nextTick;
+};
+
+struct FrameStats {
+    int numFrames;
+    double averageMs;
+    double onePercentLowMs;     //Mean of the slowest 1% of frames
+    double pointOnePercentLowMs;
+    double worstMs;
+};
+
+//Opens the file and writes the header with the starting pose.
+int startDemoRecording(const char* path, const struct Player* player);
+//Ticks reach the file in blocks of about a second, so a crash loses at most the last block.
+void recordDemoTick(int walkDirection, int turnDirection, uint32_t deltaMs);
+//Writes the remaining ticks, fills in the tick count in the header and closes the file.
+void stopDemoRecording(void);
+
+//Files whose recording never finished load with every complete tick on disk.
+
+int loadDemo(struct Demo* demo, const char* path);
+void freeDemo(struct Demo* demo);
+//Puts the player at the start of the demo and rewinds to its first tick.
+void rewindDemo(struct Demo* demo, struct Player* player);
+int isDemoFinished(const struct Demo* demo);
+//Applies the next tick's inputs to the player and returns its time step in milliseconds.
+uint32_t playDemoTick(struct Demo* demo, struct Player* player);
+
+//Sorts frameMs in place.
+void computeFrameStats(double* frameMs, int numFrames, struct FrameStats* stats);
+
+#endif /* demo_h */
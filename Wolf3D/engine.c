@@ -0,0 +1,263 @@
+//
+//  engine.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/29/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "engine.h"
+#include "textures.h"
+
+void initWorld(struct World* world, const int* map, int numCols, int numRows) {
+    memset(world, 0, sizeof(*world));
+    world->map = map;
+    world->numCols = numCols;
+    world->numRows = numRows;
+
+    //Load textures from textures.h
+    world->textures[0] = (const uint32_t*) REDBRICK_TEXTURE;
+    world->textures[1] = (const uint32_t*) PURPLESTONE_TEXTURE;
+    world->textures[2] = (const uint32_t*) MOSSYSTONE_TEXTURE;
+    world->textures[3] = (const uint32_t*) GRAYSTONE_TEXTURE;
+    world->textures[4] = (const uint32_t*) COLORSTONE_TEXTURE;
+    world->textures[5] = (const uint32_t*) BLUESTONE_TEXTURE;
+    world->textures[6] = (const uint32_t*) WOOD_TEXTURE;
+    world->textures[7] = (const uint32_t*) EAGLE_TEXTURE;
+}
+
+void destroyWorld(struct World* world) {
+    for(int i = 0; i < NUM_TEXTURES; i++) {
+        free(world->indexedTextures[i]);
+        world->indexedTextures[i] = NULL;
+    }
+}
+
+static int findPaletteIndex(struct World* world, uint32_t color) {
+    for(int i = 0; i < world->numPaletteColors; i++) {
+        if(world->palette[i] == color) {
+            return i;
+        }
+    }
+    if(world->numPaletteColors == PALETTE_SIZE) {
+        return -1;
+    }
+    world->palette[world->numPaletteColors] = color;
+    return world->numPaletteColors++;
+}
+
+//The first palette entries are reserved for the clear, ceiling and floor colors
+//so the column code can use fixed indices.
+int buildIndexedTextures(struct World* world) {
+    world->numPaletteColors = 0;
+    findPaletteIndex(world, 0xff000000);
+    findPaletteIndex(world, CEILING_COLOR);
+    findPaletteIndex(world, FLOOR_COLOR);
+
+    for(int i = 0; i < NUM_TEXTURES; i++) {
+        world->indexedTextures[i] = (uint8_t*) malloc(sizeof(uint8_t) * TEXTURE_WIDTH * TEXTURE_HEIGHT);
+        for(int j = 0; j < TEXTURE_WIDTH * TEXTURE_HEIGHT; j++) {
+            int index = findPaletteIndex(world, world->textures[i][j]);
+            if(index < 0) {
+                fprintf(stderr, "Textures use more than %d colors, falling back to 32-bit rendering \n", PALETTE_SIZE);
+                destroyWorld(world);
+                return FALSE;
+            }
+            world->indexedTextures[i][j] = (uint8_t) index;
+        }
+    }
+    return TRUE;
+}
+
+int createRenderContext(struct RenderContext* context, const struct World* world, int width, int height,
+                        uint32_t* colorBuffer, int useIndexedColor) {
+    memset(context, 0, sizeof(*context));
+    //Callers that never chose an ISA get the best one the host supports.
+    if(!kernels.castRays) {
+        selectRenderKernels(NULL);
+    }
+    context->world = world;
+    context->width = width;
+    context->height = height;
+    context->numRays = width;
+    context->useIndexedColor = useIndexedColor && world->indexedTextures[0] != NULL;
+    resetPlayer(&context->state.player, world->numCols * TILE_SIZE / 2, world->numRows * TILE_SIZE / 2, PI/2);
+
+    context->rays = (struct Ray*) malloc(sizeof(struct Ray) * (size_t)context->numRays);
+    context->ownsColorBuffer = colorBuffer == NULL;
+    context->colorBuffer = colorBuffer ? colorBuffer : (uint32_t*) malloc(sizeof(uint32_t) * (size_t)width * height);
+    if(context->useIndexedColor) {
+        context->indexedBuffer = (uint8_t*) malloc(sizeof(uint8_t) * (size_t)width * height);
+    }
+    if(!context->rays || !context->colorBuffer || (context->useIndexedColor && !context->indexedBuffer)) {
+        destroyRenderContext(context);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void destroyRenderContext(struct RenderContext* context) {
+    free(context->rays);
+    free(context->indexedBuffer);
+    if(context->ownsColorBuffer) {
+        free(context->colorBuffer);
+    }
+    context->rays = NULL;
+    context->indexedBuffer = NULL;
+    context->colorBuffer = NULL;
+}
+
+void resetPlayer(struct Player* player, float x, float y, float rotationAngle) {
+    player->x = x;
+    player->y = y;
+    player->width = 5;
+    player->height = 5;
+    player->turnDirection = 0;
+    player->walkDirection = 0;
+    player->rotationAngle = rotationAngle;
+    player->walkSpeed = 100;
+    player->turnSpeed = 45 * (PI/180);
+}
+
+static int isWallTile(const struct World* world, int col, int row) {
+    if(col < 0 || col >= world->numCols || row < 0 || row >= world->numRows) {
+        return TRUE;
+    }
+    return world->map[row * world->numCols + col] != 0;
+}
+
+//Pushes the circle out of every wall tile it overlaps, along the line from the
+//closest point of the tile to its center.
+static void pushOutOfWalls(const struct World* world, float* x, float* y, float radius) {
+    int minCol = (int)floorf((*x - radius) / TILE_SIZE);
+    int maxCol = (int)floorf((*x + radius) / TILE_SIZE);
+    int minRow = (int)floorf((*y - radius) / TILE_SIZE);
+    int maxRow = (int)floorf((*y + radius) / TILE_SIZE);
+    for(int row = minRow; row <= maxRow; row++) {
+        for(int col = minCol; col <= maxCol; col++) {
+            if(!isWallTile(world, col, row)) {
+                continue;
+            }
+            float left = col * TILE_SIZE;
+            float top = row * TILE_SIZE;
+            float nearestX = *x < left ? left : (*x > left + TILE_SIZE ? left + TILE_SIZE : *x);
+            float nearestY = *y < top ? top : (*y > top + TILE_SIZE ? top + TILE_SIZE : *y);
+            float dx = *x - nearestX;
+            float dy = *y - nearestY;
+            float distanceSquared = dx * dx + dy * dy;
+            if(distanceSquared >= radius * radius) {
+                continue;
+            }
+            if(distanceSquared > 0) {
+                float distance = sqrtf(distanceSquared);
+                float push = (radius - distance) / distance;
+                *x += dx * push;
+                *y += dy * push;
+            }
+            else {
+                //The center is inside the tile: leave through the nearest side.
+                float toLeft = *x - left;
+                float toRight = left + TILE_SIZE - *x;
+                float toTop = *y - top;
+                float toBottom = top + TILE_SIZE - *y;
+                float nearest = fminf(fminf(toLeft, toRight), fminf(toTop, toBottom));
+                if(nearest == toLeft) {
+                    *x = left - radius;
+                }
+                else if(nearest == toRight) {
+                    *x = left + TILE_SIZE + radius;
+                }
+                else if(nearest == toTop) {
+                    *y = top - radius;
+                }
+                else {
+                    *y = top + TILE_SIZE + radius;
+                }
+            }
+        }
+    }
+}
+
+void slideCircle(const struct World* world, float* x, float* y, float dx, float dy, float radius) {
+    float length = fmaxf(fabsf(dx), fabsf(dy));
+    int numSteps = length > radius ? (int)ceilf(length / radius) : 1;
+    for(int i = 0; i < numSteps; i++) {
+        *x += dx / numSteps;
+        *y += dy / numSteps;
+        pushOutOfWalls(world, x, y, radius);
+    }
+}
+
+void movePlayer(struct RenderContext* context, float deltaTime) {
+    struct Player* player = &context->state.player;
+    player->rotationAngle += player->turnDirection * player->turnSpeed * deltaTime;
+    int moveStep = player->walkDirection * player->walkSpeed * deltaTime;
+
+    //Wall collision: slide along walls instead of stopping at them.
+    slideCircle(context->world, &player->x, &player->y, cos(player->rotationAngle) * moveStep,
+                sin(player->rotationAngle) * moveStep, player->width / 2);
+    context->state.tick++;
+    context->state.time += deltaTime;
+}
+
+void castAllRays(struct RenderContext* context) {
+    const struct World* world = context->world;
+    //Start first ray subtracting half of our FOV
+    float rayAngle = context->state.player.rotationAngle - (FOV_ANGLE/2);
+    kernels.castRays(world->map, world->numCols, world->numRows, context->state.player.x, context->state.player.y,
+                     rayAngle, FOV_ANGLE / context->numRays, context->rays, context->numRays);
+}
+
+void generate3DProjection(struct RenderContext* context) {
+    const struct World* world = context->world;
+    if(context->useIndexedColor) {
+        kernels.drawIndexedWalls(context->rays, context->numRays, context->state.player.rotationAngle, context->indexedBuffer,
+                                 context->width, context->height, (const uint8_t* const*) world->indexedTextures, context->columns);
+    }
+    else {
+        kernels.drawWalls(context->rays, context->numRays, context->state.player.rotationAngle, context->colorBuffer,
+                          context->width, context->height, world->textures, context->columns);
+    }
+}
+
+void resolveColorBuffer(struct RenderContext* context) {
+    if(context->useIndexedColor) {
+        //Expand the 8-bit frame into colorBuffer once, right before presenting it.
+        kernels.expandPalette(context->colorBuffer, context->indexedBuffer, context->world->palette,
+                              context->width * context->height);
+    }
+}
+
+void clearColorBuffer(struct RenderContext* context, uint32_t color) {
+    kernels.clearBuffer(context->colorBuffer, context->width * context->height, color);
+}
+
+void clearIndexedBuffer(struct RenderContext* context, uint8_t index) {
+    memset(context->indexedBuffer, index, (size_t)context->width * context->height);
+}
+
+void expandColumnInfo(const struct RenderContext* context, float* depth, uint8_t* tileIds, int8_t* normals) {
+    static const int8_t faceNormals[4][2] = { {0, -1}, {0, 1}, {-1, 0}, {1, 0} };
+    int width = context->width;
+    for(int i = 0; i < context->numRays; i++) {
+        const struct ColumnInfo* column = &context->columns[i];
+        for(int y = 0; y < context->height; y++) {
+            int isWall = y >= column->wallTopPixel && y < column->wallBottomPixel;
+            size_t pixel = (size_t)y * width + i;
+            if(depth) {
+                depth[pixel] = isWall ? column->depth : INFINITY;
+            }
+            if(tileIds) {
+                tileIds[pixel] = isWall ? column->tileId : 0;
+            }
+            if(normals) {
+                normals[2 * pixel] = isWall ? faceNormals[column->face][0] : 0;
+                normals[2 * pixel + 1] = isWall ? faceNormals[column->face][1] : 0;
+            }
+        }
+    }
+}
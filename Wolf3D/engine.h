@@ -0,0 +1,104 @@
+//
+//  engine.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/29/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef engine_h
+#define engine_h
+
+#include <stdint.h>
+#include "constants.h"
+#include "kernels.h"
+
+struct Player {
+    float x;
+    float y;
+    float width;
+    float height;
+    int turnDirection; //-1: left, 1:right
+    int walkDirection; //-1: back, 1:front
+    float rotationAngle;
+    float walkSpeed;
+    float turnSpeed;
+};
+
+//All mutable simulation state of one view, as plain data: copying the struct is a
+//complete snapshot. The map belongs to the World and never changes, so snapshots
+//stay this size whatever the map. Entities (see entities.h) are not part of it:
+//their store grows with the entity count, and a snapshot must stay a fixed-size
+//copy, so snapshots, rewind and state diffs cover the player and clock only.
+struct WorldState {
+    struct Player player;
+    uint32_t tick;
+    float time;         //Simulated seconds, the sum of every deltaTime so far
+};
+
+//Read-only assets. One World can be shared by any number of render contexts,
+//on any number of threads, as long as nobody modifies it while they render.
+struct World {
+    const int* map;
+    int numCols;
+    int numRows;
+    const uint32_t* textures[NUM_TEXTURES];
+    uint8_t* indexedTextures[NUM_TEXTURES];
+    uint32_t palette[PALETTE_SIZE];
+    int numPaletteColors;
+};
+
+//Everything one view needs to simulate and draw a frame. Contexts don't share
+//mutable state, so each thread can own one and render without locks.
+struct RenderContext {
+    const struct World* world;
+    struct WorldState state;
+    int width;
+    int height;
+    int numRays;
+    struct Ray* rays;
+    uint32_t* colorBuffer;
+    uint8_t* indexedBuffer;
+    int useIndexedColor;
+    int ownsColorBuffer;
+    //Optional, caller-owned array of numRays entries filled by generate3DProjection().
+    //Leave it NULL when nobody needs depth, tile IDs or normals.
+    struct ColumnInfo* columns;
+};
+
+//map is numRows * numCols tiles, row by row; the World keeps a pointer to it.
+void initWorld(struct World* world, const int* map, int numCols, int numRows);
+void destroyWorld(struct World* world);
+
+//Converts the textures to palette indices for the 8-bit path. Returns FALSE if
+//they use more colors than the palette holds.
+int buildIndexedTextures(struct World* world);
+
+//colorBuffer may point at caller-owned memory of width * height pixels; NULL allocates one.
+//useIndexedColor needs buildIndexedTextures() to have succeeded on the world.
+//Selects the render kernels if selectRenderKernels() hasn't been called yet. Create the
+//first context before starting threads that render, since the kernel table is global.
+int createRenderContext(struct RenderContext* context, const struct World* world, int width, int height,
+                        uint32_t* colorBuffer, int useIndexedColor);
+void destroyRenderContext(struct RenderContext* context);
+
+void resetPlayer(struct Player* player, float x, float y, float rotationAngle);
+
+//Moves a circle by (dx, dy) and pushes it out of any wall tile it ends up in, so it
+//slides along walls instead of stopping. Moves longer than the radius are split so
+//nothing tunnels through a wall. Outside the map counts as wall.
+void slideCircle(const struct World* world, float* x, float* y, float dx, float dy, float radius);
+void movePlayer(struct RenderContext* context, float deltaTime);
+void castAllRays(struct RenderContext* context);
+void generate3DProjection(struct RenderContext* context);
+
+//Turns the frame into ARGB in colorBuffer (a no-op unless it was drawn in 8-bit).
+void resolveColorBuffer(struct RenderContext* context);
+void clearColorBuffer(struct RenderContext* context, uint32_t color);
+void clearIndexedBuffer(struct RenderContext* context, uint8_t index);
+
+//Expands context->columns into per-pixel images of width * height. Any output may be NULL.
+//normals holds an x, y pair per pixel. Ceiling and floor get depth INFINITY, tile 0 and normal 0, 0.
+void expandColumnInfo(const struct RenderContext* context, float* depth, uint8_t* tileIds, int8_t* normals);
+
+#endif /* engine_h */
@@ -0,0 +1,219 @@
+//
+//  entities.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/2/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "entities.h"
+#include "mapgen.h"
+#include "trace.h"
+
+//Entities handed to a worker at a time. Once sorted, a chunk covers a few regions.
+#define ENTITY_GRAIN_SIZE 1024
+
+struct EntityJob {
+    struct EntityStore* store;
+    const struct World* world;
+    const struct FlowField* field;
+    float targetX;
+    float targetY;
+    float deltaTime;
+};
+
+int createEntityStore(struct EntityStore* store, const struct World* world, int capacity) {
+    memset(store, 0, sizeof(*store));
+    int regionSize = 1 << ENTITY_REGION_SHIFT;
+    store->capacity = capacity;
+    store->numRegionCols = (world->numCols + regionSize - 1) >> ENTITY_REGION_SHIFT;
+    store->numRegions = store->numRegionCols * ((world->numRows + regionSize - 1) >> ENTITY_REGION_SHIFT);
+    size_t size = (size_t)capacity;
+    store->x = (float*) malloc(sizeof(float) * size);
+    store->y = (float*) malloc(sizeof(float) * size);
+    store->velocityX = (float*) malloc(sizeof(float) * size);
+    store->velocityY = (float*) malloc(sizeof(float) * size);
+    store->radius = (float*) malloc(sizeof(float) * size);
+    store->state = (uint8_t*) malloc(sizeof(uint8_t) * size);
+    store->canSeeTarget = (uint8_t*) calloc(size, sizeof(uint8_t));
+    store->regionCounts = (int*) malloc(sizeof(int) * (size_t)(store->numRegions + 1));
+    store->regionOf = (int*) malloc(sizeof(int) * size);
+    store->scratch = (float*) malloc(sizeof(float) * size);
+    store->scratchState = (uint8_t*) malloc(sizeof(uint8_t) * size);
+    store->sightDirectionX = (float*) malloc(sizeof(float) * size);
+    store->sightDirectionY = (float*) malloc(sizeof(float) * size);
+    store->sightMaxDistance = (float*) malloc(sizeof(float) * size);
+    store->sightCell = (int*) malloc(sizeof(int) * size);
+    store->sightDistance = (float*) malloc(sizeof(float) * size);
+    store->sightSide = (uint8_t*) malloc(sizeof(uint8_t) * size);
+    if(!store->x || !store->y || !store->velocityX || !store->velocityY || !store->radius || !store->state
+       || !store->canSeeTarget || !store->regionCounts || !store->regionOf || !store->scratch || !store->scratchState
+       || !store->sightDirectionX || !store->sightDirectionY || !store->sightMaxDistance || !store->sightCell
+       || !store->sightDistance || !store->sightSide) {
+        destroyEntityStore(store);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void destroyEntityStore(struct EntityStore* store) {
+    free(store->x);
+    free(store->y);
+    free(store->velocityX);
+    free(store->velocityY);
+    free(store->radius);
+    free(store->state);
+    free(store->canSeeTarget);
+    free(store->regionCounts);
+    free(store->regionOf);
+    free(store->scratch);
+    free(store->scratchState);
+    free(store->sightDirectionX);
+    free(store->sightDirectionY);
+    free(store->sightMaxDistance);
+    free(store->sightCell);
+    free(store->sightDistance);
+    free(store->sightSide);
+    memset(store, 0, sizeof(*store));
+}
+
+int addEntity(struct EntityStore* store, float x, float y, float radius) {
+    if(store->count == store->capacity) {
+        return -1;
+    }
+    int i = store->count++;
+    store->x[i] = x;
+    store->y[i] = y;
+    store->velocityX[i] = 0;
+    store->velocityY[i] = 0;
+    store->radius[i] = radius;
+    store->state[i] = ENTITY_IDLE;
+    store->canSeeTarget[i] = FALSE;
+    return i;
+}
+
+void spawnEntities(struct EntityStore* store, const struct World* world, int count, uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    int numTiles = world->numCols * world->numRows;
+    for(int i = 0; i < count; i++) {
+        int tile;
+        do {
+            tile = (int)(nextRandom(&state) % (uint32_t)numTiles);
+        } while(world->map[tile] != 0);
+        //Keep the whole circle inside the tile so nobody spawns overlapping a wall.
+        float margin = ENTITY_RADIUS;
+        float x = (tile % world->numCols) * TILE_SIZE + margin + nextRandomFloat(&state) * (TILE_SIZE - 2 * margin);
+        float y = (tile / world->numCols) * TILE_SIZE + margin + nextRandomFloat(&state) * (TILE_SIZE - 2 * margin);
+        if(addEntity(store, x, y, ENTITY_RADIUS) < 0) {
+            return;
+        }
+    }
+}
+
+static void permuteFloats(struct EntityStore* store, float** array, const int* destination) {
+    for(int i = 0; i < store->count; i++) {
+        store->scratch[destination[i]] = (*array)[i];
+    }
+    float* sorted = store->scratch;
+    store->scratch = *array;
+    *array = sorted;
+}
+
+//Counting sort by region. Stable, so entities that stay put keep their order.
+static void sortByRegion(struct EntityStore* store) {
+    int* counts = store->regionCounts;
+    memset(counts, 0, sizeof(int) * (size_t)(store->numRegions + 1));
+    int regionCols = store->numRegionCols;
+    for(int i = 0; i < store->count; i++) {
+        int col = (int)(store->x[i] / TILE_SIZE) >> ENTITY_REGION_SHIFT;
+        int row = (int)(store->y[i] / TILE_SIZE) >> ENTITY_REGION_SHIFT;
+        int region = row * regionCols + col;
+        region = region < 0 ? 0 : (region >= store->numRegions ? store->numRegions - 1 : region);
+        store->regionOf[i] = region;
+        counts[region + 1]++;
+    }
+    for(int r = 0; r < store->numRegions; r++) {
+        counts[r + 1] += counts[r];
+    }
+    //regionOf becomes each entity's destination index.
+    for(int i = 0; i < store->count; i++) {
+        store->regionOf[i] = counts[store->regionOf[i]]++;
+    }
+    permuteFloats(store, &store->x, store->regionOf);
+    permuteFloats(store, &store->y, store->regionOf);
+    permuteFloats(store, &store->velocityX, store->regionOf);
+    permuteFloats(store, &store->velocityY, store->regionOf);
+    permuteFloats(store, &store->radius, store->regionOf);
+    for(int i = 0; i < store->count; i++) {
+        store->scratchState[store->regionOf[i]] = store->state[i];
+    }
+    uint8_t* sortedState = store->scratchState;
+    store->scratchState = store->state;
+    store->state = sortedState;
+}
+
+static void updateEntityRange(void* data, int begin, int end) {
+    struct EntityJob* job = (struct EntityJob*) data;
+    struct EntityStore* store = job->store;
+    float* restrict x = store->x;
+    float* restrict y = store->y;
+    float* restrict velocityX = store->velocityX;
+    float* restrict velocityY = store->velocityY;
+
+    //Steering: one flow-field lookup per entity.
+    for(int i = begin; i < end; i++) {
+        float dirX, dirY;
+        if(!flowSteer(job->field, x[i], y[i], job->targetX, job->targetY, &dirX, &dirY)) {
+            store->state[i] = ENTITY_IDLE;
+            dirX = 0;
+            dirY = 0;
+        }
+        else {
+            store->state[i] = flowDistance(job->field, x[i], y[i]) == 0 ? ENTITY_ARRIVED : ENTITY_CHASING;
+        }
+        velocityX[i] = dirX * ENTITY_SPEED;
+        velocityY[i] = dirY * ENTITY_SPEED;
+    }
+
+    //Movement and collision. Only entities near a wall need the tile tests, but
+    //slideCircle() is cheap when every overlapped tile is empty.
+    for(int i = begin; i < end; i++) {
+        slideCircle(job->world, &x[i], &y[i], velocityX[i] * job->deltaTime, velocityY[i] * job->deltaTime, store->radius[i]);
+    }
+}
+
+void updateEntities(struct EntityStore* store, const struct World* world, const struct FlowField* field,
+                    float targetX, float targetY, float deltaTime, struct ThreadPool* pool) {
+    if(store->count == 0) {
+        return;
+    }
+    sortByRegion(store);
+    struct EntityJob job = { store, world, field, targetX, targetY, deltaTime };
+    parallelFor(pool, store->count, ENTITY_GRAIN_SIZE, updateEntityRange, &job);
+}
+
+void checkEntitySight(struct EntityStore* store, const struct World* world, const struct PvsView* view,
+                      float targetX, float targetY, struct ThreadPool* pool) {
+    //Entities the PVS rules out get a zero direction, which the trace gives up on at once.
+    //It only rules on cells inside its window; everything further out is traced.
+    for(int i = 0; i < store->count; i++) {
+        int isCandidate = !view || !pvsViewCovers(view, store->x[i], store->y[i])
+        || pvsViewCanSee(view, store->x[i], store->y[i]);
+        float dx = targetX - store->x[i];
+        float dy = targetY - store->y[i];
+        store->canSeeTarget[i] = (uint8_t)isCandidate;
+        store->sightDirectionX[i] = isCandidate ? dx : 0;
+        store->sightDirectionY[i] = isCandidate ? dy : 0;
+        store->sightMaxDistance[i] = isCandidate ? sqrtf(dx * dx + dy * dy) : 0;
+    }
+    struct TraceQueries queries = { store->count, store->x, store->y, store->sightDirectionX, store->sightDirectionY,
+        store->sightMaxDistance };
+    struct TraceResults results = { store->sightCell, store->sightDistance, store->sightSide };
+    traceBatch(world, &queries, &results, pool);
+    for(int i = 0; i < store->count; i++) {
+        store->canSeeTarget[i] &= store->sightSide[i] == TRACE_MISS;
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  entities.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/2/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef entities_h
+#define entities_h
+
+#include <stdint.h>
+#include "engine.h"
+#include "flowfield.h"
+#include "pvs.h"
+#include "threadpool.h"
+
+#define ENTITY_RADIUS 8.0f
+#define ENTITY_SPEED 60.0f
+//Regions are 2^ENTITY_REGION_SHIFT tiles on a side.
+#define ENTITY_REGION_SHIFT 3
+
+enum EntityState {
+    ENTITY_IDLE,        //No path to the target
+    ENTITY_CHASING,
+    ENTITY_ARRIVED      //In the target's tile
+};
+
+//Structure of arrays: each field is its own contiguous array indexed by entity, so
+//the update loops stream through exactly the data they touch.
+//Entities are kept sorted by map region, which moves them to new indices.
+struct EntityStore {
+    int count;
+    int capacity;
+    float* x;
+    float* y;
+    float* velocityX;
+    float* velocityY;
+    float* radius;
+    uint8_t* state;
+    uint8_t* canSeeTarget;  //Written by checkEntitySight(), stale once the entities move
+
+    //Region sort scratch space
+    int numRegionCols;
+    int numRegions;
+    int* regionCounts;
+    int* regionOf;
+    float* scratch;
+    uint8_t* scratchState;
+
+    //Sight query scratch space
+    float* sightDirectionX;
+    float* sightDirectionY;
+    float* sightMaxDistance;
+    int* sightCell;
+    float* sightDistance;
+    uint8_t* sightSide;
+};
+
+int createEntityStore(struct EntityStore* store, const struct World* world, int capacity);
+void destroyEntityStore(struct EntityStore* store);
+
+//Returns the new entity's index, or -1 if the store is full.
+int addEntity(struct EntityStore* store, float x, float y, float radius);
+//Adds count entities at random spots in empty tiles.
+void spawnEntities(struct EntityStore* store, const struct World* world, int count, uint32_t seed);
+
+//Steers every entity along the flow field toward (targetX, targetY), then moves it with
+//circle-versus-tile collision. Entities are sorted into map regions first so each
+//worker gets a spatially coherent run of them.
+void updateEntities(struct EntityStore* store, const struct World* world, const struct FlowField* field,
+                    float targetX, float targetY, float deltaTime, struct ThreadPool* pool);
+
+//Sets canSeeTarget for every entity with a clear straight line to (targetX, targetY).
+//view, if not NULL, is the target's PVS view: entities in cells its window rules out
+//are not traced. Entities beyond the window always are. The PVS only hides cells no
+//sight line reaches, so the answers match tracing every entity; -validate checks that.
+void checkEntitySight(struct EntityStore* store, const struct World* world, const struct PvsView* view,
+                      float targetX, float targetY, struct ThreadPool* pool);
+
+#endif /* entities_h */
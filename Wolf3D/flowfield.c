@@ -0,0 +1,172 @@
+//
+//  flowfield.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/2/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <math.h>
+#include "constants.h"
+#include "flowfield.h"
+
+#define FLOW_AT_TARGET 4
+
+static const int neighborOffsets[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+int createFlowField(struct FlowField* field, const int* map, int numCols, int numRows) {
+    size_t numTiles = (size_t)numCols * numRows;
+    field->map = map;
+    field->numCols = numCols;
+    field->numRows = numRows;
+    field->published = -1;
+    field->publishedTarget = -1;
+    field->wantedTarget = -1;
+    field->buildingTarget = -1;
+    field->queue = (int*) malloc(sizeof(int) * numTiles);
+    int ok = field->queue != NULL;
+    for(int i = 0; i < 2; i++) {
+        struct FlowBuffer* buffer = &field->buffers[i];
+        buffer->stamp = (uint32_t*) calloc(numTiles, sizeof(uint32_t));
+        buffer->distance = (uint32_t*) malloc(sizeof(uint32_t) * numTiles);
+        buffer->direction = (uint8_t*) malloc(sizeof(uint8_t) * numTiles);
+        buffer->generation = 0;
+        ok = ok && buffer->stamp && buffer->distance && buffer->direction;
+    }
+    if(!ok) {
+        destroyFlowField(field);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void destroyFlowField(struct FlowField* field) {
+    for(int i = 0; i < 2; i++) {
+        free(field->buffers[i].stamp);
+        free(field->buffers[i].distance);
+        free(field->buffers[i].direction);
+        field->buffers[i].stamp = NULL;
+        field->buffers[i].distance = NULL;
+        field->buffers[i].direction = NULL;
+    }
+    free(field->queue);
+    field->queue = NULL;
+}
+
+static int tileAtPosition(const struct FlowField* field, float x, float y) {
+    int col = (int)floorf(x / TILE_SIZE);
+    int row = (int)floorf(y / TILE_SIZE);
+    if(col < 0 || col >= field->numCols || row < 0 || row >= field->numRows) {
+        return -1;
+    }
+    return row * field->numCols + col;
+}
+
+void setFlowTarget(struct FlowField* field, float x, float y) {
+    int tile = tileAtPosition(field, x, y);
+    if(tile >= 0 && field->map[tile] == 0) {
+        field->wantedTarget = tile;
+    }
+}
+
+static void startBuild(struct FlowField* field, int target) {
+    struct FlowBuffer* buffer = &field->buffers[field->published == 0 ? 1 : 0];
+    //A fresh generation invalidates the whole buffer without touching it.
+    buffer->generation++;
+    if(buffer->generation == 0) {
+        for(size_t i = 0; i < (size_t)field->numCols * field->numRows; i++) {
+            buffer->stamp[i] = 0;
+        }
+        buffer->generation = 1;
+    }
+    buffer->stamp[target] = buffer->generation;
+    buffer->distance[target] = 0;
+    buffer->direction[target] = FLOW_AT_TARGET;
+    field->queue[0] = target;
+    field->queueHead = 0;
+    field->queueTail = 1;
+    field->buildingTarget = target;
+}
+
+int updateFlowField(struct FlowField* field, int maxTiles) {
+    //A build always runs to completion, even if the target moves meanwhile; restarting
+    //instead could starve a large map of any field at all. The next build catches up.
+    if(field->buildingTarget < 0) {
+        if(field->wantedTarget < 0 || field->wantedTarget == field->publishedTarget) {
+            return field->published >= 0;
+        }
+        startBuild(field, field->wantedTarget);
+    }
+    int building = field->published == 0 ? 1 : 0;
+    struct FlowBuffer* buffer = &field->buffers[building];
+    int numCols = field->numCols;
+    for(int expanded = 0; expanded < maxTiles && field->queueHead < field->queueTail; expanded++) {
+        int tile = field->queue[field->queueHead++];
+        int col = tile % numCols;
+        int row = tile / numCols;
+        for(int d = 0; d < 4; d++) {
+            int neighborCol = col + neighborOffsets[d][0];
+            int neighborRow = row + neighborOffsets[d][1];
+            if(neighborCol < 0 || neighborCol >= numCols || neighborRow < 0 || neighborRow >= field->numRows) {
+                continue;
+            }
+            int neighbor = neighborRow * numCols + neighborCol;
+            if(field->map[neighbor] != 0 || buffer->stamp[neighbor] == buffer->generation) {
+                continue;
+            }
+            buffer->stamp[neighbor] = buffer->generation;
+            buffer->distance[neighbor] = buffer->distance[tile] + 1;
+            //Offsets come in opposite pairs, so d ^ 1 points back at tile.
+            buffer->direction[neighbor] = (uint8_t)(d ^ 1);
+            field->queue[field->queueTail++] = neighbor;
+        }
+    }
+    if(field->queueHead < field->queueTail) {
+        return FALSE;
+    }
+    field->published = building;
+    field->publishedTarget = field->buildingTarget;
+    field->buildingTarget = -1;
+    return field->publishedTarget == field->wantedTarget;
+}
+
+static const struct FlowBuffer* publishedBuffer(const struct FlowField* field, int tile) {
+    if(field->published < 0 || tile < 0) {
+        return NULL;
+    }
+    const struct FlowBuffer* buffer = &field->buffers[field->published];
+    return buffer->stamp[tile] == buffer->generation ? buffer : NULL;
+}
+
+int flowSteer(const struct FlowField* field, float x, float y, float targetX, float targetY, float* dirX, float* dirY) {
+    int tile = tileAtPosition(field, x, y);
+    const struct FlowBuffer* buffer = publishedBuffer(field, tile);
+    if(!buffer) {
+        return FALSE;
+    }
+    int direction = buffer->direction[tile];
+    float goalX = targetX;
+    float goalY = targetY;
+    if(direction != FLOW_AT_TARGET) {
+        goalX = ((tile % field->numCols) + neighborOffsets[direction][0] + 0.5f) * TILE_SIZE;
+        goalY = ((tile / field->numCols) + neighborOffsets[direction][1] + 0.5f) * TILE_SIZE;
+    }
+    float dx = goalX - x;
+    float dy = goalY - y;
+    float length = sqrtf(dx * dx + dy * dy);
+    if(length < 1e-3f) {
+        *dirX = 0;
+        *dirY = 0;
+        return TRUE;
+    }
+    *dirX = dx / length;
+    *dirY = dy / length;
+    return TRUE;
+}
+
+int flowDistance(const struct FlowField* field, float x, float y) {
+    int tile = tileAtPosition(field, x, y);
+    const struct FlowBuffer* buffer = publishedBuffer(field, tile);
+    return buffer ? (int)buffer->distance[tile] : -1;
+}
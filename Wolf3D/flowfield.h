@@ -0,0 +1,61 @@
+//
+//  flowfield.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/2/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef flowfield_h
+#define flowfield_h
+
+#include <stdint.h>
+
+//Enough to rebuild the built-in map thousands of times over per frame, while a
+//4096x4096 map spreads its rebuild over about a thousand frames.
+#define FLOW_FIELD_TILES_PER_FRAME 16384
+
+//Breadth-first distances, in tiles, from every empty tile to the target tile, and
+//for each tile the neighbor one step closer. Any number of agents can share one field.
+struct FlowBuffer {
+    uint32_t* stamp;        //Entries are valid where stamp == generation
+    uint32_t* distance;
+    uint8_t* direction;
+    uint32_t generation;
+};
+
+//Double buffered: agents read the published buffer while the next one is built a
+//budget of tiles per frame, and the two swap when it's done.
+struct FlowField {
+    const int* map;
+    int numCols;
+    int numRows;
+    struct FlowBuffer buffers[2];
+    int published;          //Index of the buffer agents read; -1 until the first build finishes
+    int publishedTarget;
+    int wantedTarget;
+    int buildingTarget;     //-1 while idle
+    int* queue;
+    int queueHead;
+    int queueTail;
+};
+
+int createFlowField(struct FlowField* field, const int* map, int numCols, int numRows);
+void destroyFlowField(struct FlowField* field);
+
+//Points the field at a world position. Only a change of tile triggers a rebuild.
+void setFlowTarget(struct FlowField* field, float x, float y);
+
+//Advances the pending rebuild by up to maxTiles tiles. Returns TRUE once the published
+//field points at the current target.
+int updateFlowField(struct FlowField* field, int maxTiles);
+
+//O(1): the unit direction an agent at (x, y) should move in, toward the center of the
+//next tile on its path, or straight at the target inside its tile. Returns FALSE if the
+//position can't reach the target or no field has been built yet.
+int flowSteer(const struct FlowField* field, float x, float y, float targetX, float targetY, float* dirX, float* dirY);
+
+//Tiles between the tile at (x, y) and the target, or -1 if unreachable.
+int flowDistance(const struct FlowField* field, float x, float y);
+
+#endif /* flowfield_h */
@@ -0,0 +1,275 @@
+//
+//  kernels.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/27/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "constants.h"
+#include "kernels.h"
+
+//Keep every ISA variant bit-identical: no fused multiply-adds, even where the target has them.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+struct RenderKernels kernels;
+
+//One set of traversal and wall kernels, either specialized for the compiled-in sizes or generic.
+struct KernelVariant {
+    const char* name;
+    CastRaysKernel castRays;
+    DrawWallsKernel drawWalls;
+    DrawIndexedWallsKernel drawIndexedWalls;
+};
+
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+//Shifts the specialized kernels use in place of TILE_SIZE and TEXTURE_WIDTH/HEIGHT. A size
+//that isn't a power of two gets 0, which keeps the generic code for that size only.
+#define POWER_OF_TWO_SHIFT(n) ((n) == 8 ? 3 : (n) == 16 ? 4 : (n) == 32 ? 5 : (n) == 64 ? 6 \
+                               : (n) == 128 ? 7 : (n) == 256 ? 8 : (n) == 512 ? 9 : 0)
+#define TILE_SHIFT POWER_OF_TWO_SHIFT(TILE_SIZE)
+#define TEXTURE_WIDTH_SHIFT POWER_OF_TWO_SHIFT(TEXTURE_WIDTH)
+#define TEXTURE_HEIGHT_SHIFT POWER_OF_TWO_SHIFT(TEXTURE_HEIGHT)
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+#define SIZED_VARIANT_NAME "tile " TO_STRING(TILE_SIZE) ", texture " TO_STRING(TEXTURE_WIDTH) "x" TO_STRING(TEXTURE_HEIGHT)
+
+///////////////////////////////////////////
+// SCALAR
+///////////////////////////////////////////
+#define KERNEL(name) name##_scalar
+#define KERNEL_TARGET
+#include "kernels_impl.h"
+#undef KERNEL
+#undef KERNEL_TARGET
+
+static void clearBuffer_scalar(uint32_t* buffer, int count, uint32_t color) {
+    for(int i = 0; i < count; i++) {
+        buffer[i] = color;
+    }
+}
+
+static void expandPalette_scalar(uint32_t* dst, const uint8_t* src, const uint32_t* palette, int count) {
+    for(int i = 0; i < count; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+
+#ifdef KERNELS_X86
+///////////////////////////////////////////
+// SSE4.2
+///////////////////////////////////////////
+#define KERNEL(name) name##_sse42
+#define KERNEL_TARGET __attribute__((target("sse4.2")))
+#include "kernels_impl.h"
+#undef KERNEL
+#undef KERNEL_TARGET
+
+__attribute__((target("sse4.2")))
+static void clearBuffer_sse42(uint32_t* buffer, int count, uint32_t color) {
+    __m128i value = _mm_set1_epi32((int)color);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)&buffer[i], value);
+    }
+    for(; i < count; i++) {
+        buffer[i] = color;
+    }
+}
+
+__attribute__((target("sse4.2")))
+static void expandPalette_sse42(uint32_t* dst, const uint8_t* src, const uint32_t* palette, int count) {
+    //No gather before AVX2, so look the four entries up in scalar and store them together.
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i colors = _mm_set_epi32((int)palette[src[i + 3]], (int)palette[src[i + 2]],
+                                       (int)palette[src[i + 1]], (int)palette[src[i]]);
+        _mm_storeu_si128((__m128i*)&dst[i], colors);
+    }
+    for(; i < count; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+
+///////////////////////////////////////////
+// AVX2
+///////////////////////////////////////////
+#define KERNEL(name) name##_avx2
+#define KERNEL_TARGET __attribute__((target("avx2")))
+#include "kernels_impl.h"
+#undef KERNEL
+#undef KERNEL_TARGET
+
+__attribute__((target("avx2")))
+static void clearBuffer_avx2(uint32_t* buffer, int count, uint32_t color) {
+    __m256i value = _mm256_set1_epi32((int)color);
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)&buffer[i], value);
+    }
+    for(; i < count; i++) {
+        buffer[i] = color;
+    }
+}
+
+__attribute__((target("avx2")))
+static void expandPalette_avx2(uint32_t* dst, const uint8_t* src, const uint32_t* palette, int count) {
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&src[i]));
+        __m256i colors = _mm256_i32gather_epi32((const int*)palette, indices, 4);
+        _mm256_storeu_si256((__m256i*)&dst[i], colors);
+    }
+    for(; i < count; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+
+///////////////////////////////////////////
+// AVX-512
+///////////////////////////////////////////
+#define KERNEL(name) name##_avx512
+#define KERNEL_TARGET __attribute__((target("avx512f")))
+#include "kernels_impl.h"
+#undef KERNEL
+#undef KERNEL_TARGET
+
+__attribute__((target("avx512f")))
+static void clearBuffer_avx512(uint32_t* buffer, int count, uint32_t color) {
+    __m512i value = _mm512_set1_epi32((int)color);
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_si512((void*)&buffer[i], value);
+    }
+    for(; i < count; i++) {
+        buffer[i] = color;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void expandPalette_avx512(uint32_t* dst, const uint8_t* src, const uint32_t* palette, int count) {
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m512i indices = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&src[i]));
+        __m512i colors = _mm512_i32gather_epi32(indices, (const void*)palette, 4);
+        _mm512_storeu_si512((void*)&dst[i], colors);
+    }
+    for(; i < count; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+#endif
+
+static const char* isaNames[NUM_KERNEL_ISAS] = { "scalar", "sse4.2", "avx2", "avx512" };
+
+const char* isaName(enum KernelIsa isa) {
+    return isaNames[isa];
+}
+
+int isaSupported(enum KernelIsa isa) {
+    switch(isa) {
+        case ISA_SCALAR:
+            return TRUE;
+#ifdef KERNELS_X86
+        case ISA_SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case ISA_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return FALSE;
+    }
+}
+
+static const struct KernelVariant* findVariant(const struct KernelVariant* variants, int useGeneric) {
+    return useGeneric ? &variants[1] : &variants[0];
+}
+
+#define LOAD_KERNELS(out, suffix, useGeneric) \
+    const struct KernelVariant* variant = findVariant(variants_##suffix, useGeneric); \
+    (out)->variant = variant->name; \
+    (out)->castRays = variant->castRays; \
+    (out)->drawWalls = variant->drawWalls; \
+    (out)->drawIndexedWalls = variant->drawIndexedWalls; \
+    (out)->clearBuffer = clearBuffer_##suffix; \
+    (out)->expandPalette = expandPalette_##suffix
+
+static int loadKernels(enum KernelIsa isa, int useGeneric, struct RenderKernels* out) {
+    if(!isaSupported(isa)) {
+        return FALSE;
+    }
+    out->isa = isa;
+    out->name = isaName(isa);
+    switch(isa) {
+#ifdef KERNELS_X86
+        case ISA_SSE42:
+        {
+            LOAD_KERNELS(out, sse42, useGeneric);
+            break;
+        }
+        case ISA_AVX2:
+        {
+            LOAD_KERNELS(out, avx2, useGeneric);
+            break;
+        }
+        case ISA_AVX512:
+        {
+            LOAD_KERNELS(out, avx512, useGeneric);
+            break;
+        }
+#endif
+        default:
+        {
+            LOAD_KERNELS(out, scalar, useGeneric);
+            break;
+        }
+    }
+    return TRUE;
+}
+
+int loadRenderKernels(enum KernelIsa isa, struct RenderKernels* out) {
+    return loadKernels(isa, FALSE, out);
+}
+
+int loadGenericRenderKernels(enum KernelIsa isa, struct RenderKernels* out) {
+    return loadKernels(isa, TRUE, out);
+}
+
+void selectRenderKernels(const char* forcedIsa) {
+    if(forcedIsa) {
+        int isa = 0;
+        while(isa < NUM_KERNEL_ISAS && strcmp(forcedIsa, isaNames[isa]) != 0) {
+            isa++;
+        }
+        if(isa == NUM_KERNEL_ISAS) {
+            fprintf(stderr, "Unknown kernel ISA %s, detecting instead \n", forcedIsa);
+        }
+        else if(loadRenderKernels((enum KernelIsa)isa, &kernels)) {
+            return;
+        }
+        else {
+            fprintf(stderr, "CPU does not support %s kernels, detecting instead \n", forcedIsa);
+        }
+    }
+    for(int isa = NUM_KERNEL_ISAS - 1; isa >= 0; isa--) {
+        if(loadRenderKernels((enum KernelIsa)isa, &kernels)) {
+            return;
+        }
+    }
+}
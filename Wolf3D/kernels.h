@@ -0,0 +1,88 @@
+//
+//  kernels.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/27/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef kernels_h
+#define kernels_h
+
+#include <stdint.h>
+
+struct Ray {
+    float rayAngle;
+    float wallHitX;
+    float wallHitY;
+    int wasHitVertical;
+    float distance;
+    int isRayFacingUp;
+    int isRayFacingDown;
+    int isRayFacingLeft;
+    int isRayFacingRight;
+    int wallHitContent;
+};
+
+enum WallFace {
+    FACE_NORTH,     //Facing -y, hit by rays heading down the map
+    FACE_SOUTH,
+    FACE_WEST,      //Facing -x, hit by rays heading right
+    FACE_EAST
+};
+
+//Per-column auxiliary output of the wall pass. Together with the span it describes
+//every pixel: rows above wallTopPixel are ceiling, rows from wallBottomPixel on are floor.
+struct ColumnInfo {
+    float depth;            //Perpendicular distance to the wall, in world units
+    int16_t wallTopPixel;
+    int16_t wallBottomPixel;
+    uint8_t tileId;         //Map content of the wall tile
+    uint8_t face;           //enum WallFace
+};
+
+enum KernelIsa {
+    ISA_SCALAR,
+    ISA_SSE42,
+    ISA_AVX2,
+    ISA_AVX512,
+    NUM_KERNEL_ISAS
+};
+
+typedef void (*CastRaysKernel)(const int* map, int numCols, int numRows, float originX, float originY,
+                               float firstAngle, float angleStep, struct Ray* rays, int numRays);
+//columns may be NULL; otherwise it receives one ColumnInfo per ray.
+typedef void (*DrawWallsKernel)(const struct Ray* rays, int numRays, float cameraAngle, uint32_t* buffer, int width, int height,
+                                const uint32_t* const* textures, struct ColumnInfo* columns);
+typedef void (*DrawIndexedWallsKernel)(const struct Ray* rays, int numRays, float cameraAngle, uint8_t* buffer, int width, int height,
+                                       const uint8_t* const* textures, struct ColumnInfo* columns);
+
+//The hot renderer loops, built once per instruction set in kernels.c.
+//selectRenderKernels() picks the best set the CPU supports at startup, and within
+//it the variant specialized for the compiled-in TILE_SIZE and TEXTURE_WIDTH/HEIGHT.
+struct RenderKernels {
+    enum KernelIsa isa;
+    const char* name;
+    const char* variant;
+    CastRaysKernel castRays;
+    DrawWallsKernel drawWalls;
+    DrawIndexedWallsKernel drawIndexedWalls;
+    void (*clearBuffer)(uint32_t* buffer, int count, uint32_t color);
+    void (*expandPalette)(uint32_t* dst, const uint8_t* src, const uint32_t* palette, int count);
+};
+
+extern struct RenderKernels kernels;
+
+int isaSupported(enum KernelIsa isa);
+const char* isaName(enum KernelIsa isa);
+
+//Fills out with the kernels built for isa. Returns FALSE if the host can't run them.
+int loadRenderKernels(enum KernelIsa isa, struct RenderKernels* out);
+//Same, but always with the generic variant rather than the size-specialized one.
+int loadGenericRenderKernels(enum KernelIsa isa, struct RenderKernels* out);
+
+//Selects the kernels for the best ISA the host supports. forcedIsa ("scalar", "sse4.2",
+//"avx2" or "avx512") overrides the choice for benchmarking; NULL means auto-detect.
+void selectRenderKernels(const char* forcedIsa);
+
+#endif /* kernels_h */
@@ -0,0 +1,337 @@
+//
+//  kernels_impl.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/27/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+//Kernel bodies shared by every ISA variant. kernels.c includes this file once per
+//instruction set, with KERNEL(name) giving each copy a unique name and KERNEL_TARGET
+//the target attribute the compiler should generate that copy for.
+//
+//The bodies also take the tile and texture sizes as log2 shifts. DEFINE_SIZED_KERNELS
+//at the bottom wraps them with constant shifts, so each specialized variant compiles
+//down to shifts and masks. A shift of 0 selects the generic TILE_SIZE/TEXTURE_* math.
+
+#define SIZED_TILE_SIZE(tileShift) ((tileShift) ? (1 << (tileShift)) : TILE_SIZE)
+
+//Coordinates inside the world are never negative, so truncation matches floor() there.
+//Anything outside is clamped by tileAt() anyway.
+KERNEL_INLINE int KERNEL(tileIndex)(float v, int tileShift) {
+    return tileShift ? (int)v >> tileShift : (int)floor(v/TILE_SIZE);
+}
+
+KERNEL_INLINE int KERNEL(tileAt)(const int* map, int numCols, int numRows, float x, float y, int tileShift) {
+    int _x = KERNEL(tileIndex)(x, tileShift);
+    int _y = KERNEL(tileIndex)(y, tileShift);
+    //Points on or past the outer edge take the content of the nearest edge tile.
+    _x = _x < 0 ? 0 : (_x >= numCols ? numCols - 1 : _x);
+    _y = _y < 0 ? 0 : (_y >= numRows ? numRows - 1 : _y);
+    return map[_y * numCols + _x];
+}
+
+KERNEL_INLINE int KERNEL(mapHasWallAt)(const int* map, int numCols, int numRows, float x, float y, int tileShift) {
+    int tileSize = SIZED_TILE_SIZE(tileShift);
+    if(x < 0 || x > numCols * tileSize || y < 0 || y > numRows * tileSize) {
+        return TRUE;
+    }
+    return KERNEL(tileAt)(map, numCols, numRows, x, y, tileShift) != 0;
+}
+
+KERNEL_INLINE float KERNEL(distanceBetweenPoints)(float x1, float y1, float x2, float y2) {
+    return sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
+}
+
+KERNEL_INLINE void KERNEL(castRay)(const int* map, int numCols, int numRows, float originX, float originY, float rayAngle, struct Ray* ray, int tileShift) {
+    int tileSize = SIZED_TILE_SIZE(tileShift);
+    float worldWidth = numCols * tileSize;
+    float worldHeight = numRows * tileSize;
+
+    rayAngle = remainderf(rayAngle, TWO_PI);
+    if(rayAngle < 0) {
+        rayAngle += TWO_PI;
+    }
+
+    int isRayFacingDown = rayAngle > 0 && rayAngle < PI;
+    int isRayFacingUp = !isRayFacingDown;
+
+    int isRayFacingRight = rayAngle < 0.5 * PI || rayAngle > 1.5 * PI;
+    int isRayFacingLeft = !isRayFacingRight;
+
+    float xintercept, yintercept;
+    float xstep, ystep;
+
+    ///////////////////////////////////////////
+    // HORIZONTAL RAY-GRID INTERSECTION CODE
+    ///////////////////////////////////////////
+    int foundHorzWallHit = FALSE;
+    float horzWallHitX = 0;
+    float horzWallHitY = 0;
+    int horzWallContent = 0;
+
+    // Find the y-coordinate of the closest horizontal grid intersection
+    yintercept = KERNEL(tileIndex)(originY, tileShift) * tileSize;
+    yintercept += isRayFacingDown ? tileSize : 0;
+
+    // Find the x-coordinate of the closest horizontal grid intersection
+    xintercept = originX + (yintercept - originY) / tan(rayAngle);
+
+    // Calculate the increment xstep and ystep
+    ystep = tileSize;
+    ystep *= isRayFacingUp ? -1 : 1;
+
+    xstep = tileSize / tan(rayAngle);
+    xstep *= (isRayFacingLeft && xstep > 0) ? -1 : 1;
+    xstep *= (isRayFacingRight && xstep < 0) ? -1 : 1;
+
+    float nextHorzTouchX = xintercept;
+    float nextHorzTouchY = yintercept;
+
+    // Increment xstep and ystep until we find a wall
+    while (nextHorzTouchX >= 0 && nextHorzTouchX <= worldWidth && nextHorzTouchY >= 0 && nextHorzTouchY <= worldHeight) {
+        float xToCheck = nextHorzTouchX;
+        float yToCheck = nextHorzTouchY + (isRayFacingUp ? -1 : 0);
+
+        if (KERNEL(mapHasWallAt)(map, numCols, numRows, xToCheck, yToCheck, tileShift)) {
+            // found a wall hit
+            horzWallHitX = nextHorzTouchX;
+            horzWallHitY = nextHorzTouchY;
+            horzWallContent = KERNEL(tileAt)(map, numCols, numRows, xToCheck, yToCheck, tileShift);
+            foundHorzWallHit = TRUE;
+            break;
+        } else {
+            nextHorzTouchX += xstep;
+            nextHorzTouchY += ystep;
+        }
+    }
+
+    ///////////////////////////////////////////
+    // VERTICAL RAY-GRID INTERSECTION CODE
+    ///////////////////////////////////////////
+    int foundVertWallHit = FALSE;
+    float vertWallHitX = 0;
+    float vertWallHitY = 0;
+    int vertWallContent = 0;
+
+    // Find the x-coordinate of the closest horizontal grid intersection
+    xintercept = KERNEL(tileIndex)(originX, tileShift) * tileSize;
+    xintercept += isRayFacingRight ? tileSize : 0;
+
+    // Find the y-coordinate of the closest horizontal grid intersection
+    yintercept = originY + (xintercept - originX) * tan(rayAngle);
+
+    // Calculate the increment xstep and ystep
+    xstep = tileSize;
+    xstep *= isRayFacingLeft ? -1 : 1;
+
+    ystep = tileSize * tan(rayAngle);
+    ystep *= (isRayFacingUp && ystep > 0) ? -1 : 1;
+    ystep *= (isRayFacingDown && ystep < 0) ? -1 : 1;
+
+    float nextVertTouchX = xintercept;
+    float nextVertTouchY = yintercept;
+
+    // Increment xstep and ystep until we find a wall
+    while (nextVertTouchX >= 0 && nextVertTouchX <= worldWidth && nextVertTouchY >= 0 && nextVertTouchY <= worldHeight) {
+        float xToCheck = nextVertTouchX + (isRayFacingLeft ? -1 : 0);
+        float yToCheck = nextVertTouchY;
+
+        if (KERNEL(mapHasWallAt)(map, numCols, numRows, xToCheck, yToCheck, tileShift)) {
+            // found a wall hit
+            vertWallHitX = nextVertTouchX;
+            vertWallHitY = nextVertTouchY;
+            vertWallContent = KERNEL(tileAt)(map, numCols, numRows, xToCheck, yToCheck, tileShift);
+            foundVertWallHit = TRUE;
+            break;
+        } else {
+            nextVertTouchX += xstep;
+            nextVertTouchY += ystep;
+        }
+    }
+
+    // Calculate both horizontal and vertical hit distances and choose the smallest one
+    float horzHitDistance = foundHorzWallHit
+    ? KERNEL(distanceBetweenPoints)(originX, originY, horzWallHitX, horzWallHitY)
+    : INT_MAX;
+    float vertHitDistance = foundVertWallHit
+    ? KERNEL(distanceBetweenPoints)(originX, originY, vertWallHitX, vertWallHitY)
+    : INT_MAX;
+
+    if (vertHitDistance < horzHitDistance) {
+        ray->distance = vertHitDistance;
+        ray->wallHitX = vertWallHitX;
+        ray->wallHitY = vertWallHitY;
+        ray->wallHitContent = vertWallContent;
+        ray->wasHitVertical = TRUE;
+    } else {
+        ray->distance = horzHitDistance;
+        ray->wallHitX = horzWallHitX;
+        ray->wallHitY = horzWallHitY;
+        ray->wallHitContent = horzWallContent;
+        ray->wasHitVertical = FALSE;
+    }
+    ray->rayAngle = rayAngle;
+    ray->isRayFacingDown = isRayFacingDown;
+    ray->isRayFacingUp = isRayFacingUp;
+    ray->isRayFacingLeft = isRayFacingLeft;
+    ray->isRayFacingRight = isRayFacingRight;
+}
+
+KERNEL_INLINE void KERNEL(castRaysBody)(const int* map, int numCols, int numRows, float originX, float originY,
+                                        float firstAngle, float angleStep, struct Ray* rays, int numRays, int tileShift) {
+    float rayAngle = firstAngle;
+    for(int stripId = 0; stripId < numRays; stripId++) {
+        KERNEL(castRay)(map, numCols, numRows, originX, originY, rayAngle, &rays[stripId], tileShift);
+        rayAngle += angleStep;
+    }
+}
+
+struct KERNEL(WallSpan) {
+    float perpDistance;
+    int wallTopPixel;
+    int wallBottomPixel;
+    int textureOffsetX;
+    uint32_t textureOffsetY;
+    uint32_t textureStep;
+};
+
+KERNEL_INLINE void KERNEL(projectWall)(const struct Ray* ray, float cameraAngle, float distanceProjPlane, int height,
+                                      int tileShift, int textureWidthShift, int textureHeightShift, struct KERNEL(WallSpan)* span) {
+    int tileSize = SIZED_TILE_SIZE(tileShift);
+    int textureHeight = textureHeightShift ? 1 << textureHeightShift : TEXTURE_HEIGHT;
+
+    float perpDistance = ray->distance * cos(ray->rayAngle - cameraAngle);
+    float projectedWallHeight = (tileSize/perpDistance) * distanceProjPlane;
+    span->perpDistance = perpDistance;
+    //Clamp before the int conversion so a ray grazing a wall can't overflow.
+    int wallStripHeight = projectedWallHeight < MAX_WALL_STRIP_HEIGHT ? (int) projectedWallHeight : MAX_WALL_STRIP_HEIGHT;
+
+    int wallTopPixel = (height/2) - (wallStripHeight/2);
+    span->wallTopPixel = wallTopPixel < 0 ? 0 : wallTopPixel;
+
+    int wallBottomPixel = (height/2) + (wallStripHeight/2);
+    span->wallBottomPixel = wallBottomPixel > height ? height : wallBottomPixel;
+
+    //Calculate X offset.
+    int wallHit = (int)(ray->wasHitVertical ? ray->wallHitY : ray->wallHitX);
+    if(tileShift && textureWidthShift) {
+        int tileOffset = wallHit & (tileSize - 1);
+        span->textureOffsetX = textureWidthShift >= tileShift
+        ? tileOffset << (textureWidthShift - tileShift)
+        : tileOffset >> (tileShift - textureWidthShift);
+    }
+    else {
+        span->textureOffsetX = (wallHit % TILE_SIZE) * TEXTURE_WIDTH / TILE_SIZE;
+    }
+
+    //Step down the texture column in 16.16 fixed point. The start offset is computed
+    //from the first visible row, so strips taller than the screen skip the clipped part.
+    span->textureStep = 0;
+    span->textureOffsetY = 0;
+    if(wallStripHeight > 0) {
+        span->textureStep = ((uint32_t)textureHeight << 16) / wallStripHeight;
+        int distanceFromTop = span->wallTopPixel + (wallStripHeight/2) - (height/2);
+        span->textureOffsetY = (uint32_t)(((int64_t)distanceFromTop * textureHeight << 16) / wallStripHeight);
+    }
+}
+
+//Records what the column shows, for consumers that want depth, tile IDs or normals
+//without casting again.
+KERNEL_INLINE void KERNEL(writeColumnInfo)(const struct Ray* ray, const struct KERNEL(WallSpan)* span, struct ColumnInfo* column) {
+    column->depth = span->perpDistance;
+    column->wallTopPixel = (int16_t)span->wallTopPixel;
+    column->wallBottomPixel = (int16_t)span->wallBottomPixel;
+    column->tileId = (uint8_t)ray->wallHitContent;
+    if(ray->wasHitVertical) {
+        column->face = ray->isRayFacingRight ? FACE_WEST : FACE_EAST;
+    }
+    else {
+        column->face = ray->isRayFacingDown ? FACE_NORTH : FACE_SOUTH;
+    }
+}
+
+KERNEL_INLINE void KERNEL(drawWallsBody)(const struct Ray* rays, int numRays, float cameraAngle, uint32_t* buffer, int width, int height,
+                                        const uint32_t* const* textures, struct ColumnInfo* columns,
+                                        int tileShift, int textureWidthShift, int textureHeightShift) {
+    int textureWidth = textureWidthShift ? 1 << textureWidthShift : TEXTURE_WIDTH;
+    float distanceProjPlane = (width) / 2 / tan(FOV_ANGLE/2);
+    for(int i = 0; i < numRays; i++) {
+        struct KERNEL(WallSpan) span;
+        KERNEL(projectWall)(&rays[i], cameraAngle, distanceProjPlane, height, tileShift, textureWidthShift, textureHeightShift, &span);
+        if(columns) {
+            KERNEL(writeColumnInfo)(&rays[i], &span, &columns[i]);
+        }
+
+        const uint32_t* texture = textures[rays[i].wallHitContent-1] + span.textureOffsetX;
+        uint32_t textureOffsetY = span.textureOffsetY;
+        uint32_t* pixel = &buffer[i];
+        for(int y = 0; y < span.wallTopPixel; y++, pixel += width)
+            *pixel = CEILING_COLOR;
+
+        for(int y = span.wallTopPixel; y < span.wallBottomPixel; y++, pixel += width) {
+            *pixel = texture[(textureOffsetY >> 16) * textureWidth];
+            textureOffsetY += span.textureStep;
+        }
+
+        for(int y = span.wallBottomPixel; y < height; y++, pixel += width)
+            *pixel = FLOOR_COLOR;
+    }
+}
+
+//Same as drawWallsBody, but writes palette indices into the 8-bit frame buffer.
+KERNEL_INLINE void KERNEL(drawIndexedWallsBody)(const struct Ray* rays, int numRays, float cameraAngle, uint8_t* buffer, int width, int height,
+                                               const uint8_t* const* textures, struct ColumnInfo* columns,
+                                        int tileShift, int textureWidthShift, int textureHeightShift) {
+    int textureWidth = textureWidthShift ? 1 << textureWidthShift : TEXTURE_WIDTH;
+    float distanceProjPlane = (width) / 2 / tan(FOV_ANGLE/2);
+    for(int i = 0; i < numRays; i++) {
+        struct KERNEL(WallSpan) span;
+        KERNEL(projectWall)(&rays[i], cameraAngle, distanceProjPlane, height, tileShift, textureWidthShift, textureHeightShift, &span);
+        if(columns) {
+            KERNEL(writeColumnInfo)(&rays[i], &span, &columns[i]);
+        }
+
+        const uint8_t* texture = textures[rays[i].wallHitContent-1] + span.textureOffsetX;
+        uint32_t textureOffsetY = span.textureOffsetY;
+        uint8_t* pixel = &buffer[i];
+        for(int y = 0; y < span.wallTopPixel; y++, pixel += width)
+            *pixel = CEILING_INDEX;
+
+        for(int y = span.wallTopPixel; y < span.wallBottomPixel; y++, pixel += width) {
+            *pixel = texture[(textureOffsetY >> 16) * textureWidth];
+            textureOffsetY += span.textureStep;
+        }
+
+        for(int y = span.wallBottomPixel; y < height; y++, pixel += width)
+            *pixel = FLOOR_INDEX;
+    }
+}
+
+#define DEFINE_SIZED_KERNELS(tag, tileShift, textureWidthShift, textureHeightShift) \
+KERNEL_TARGET \
+static void KERNEL(castRays_##tag)(const int* map, int numCols, int numRows, float originX, float originY, \
+                                   float firstAngle, float angleStep, struct Ray* rays, int numRays) { \
+    KERNEL(castRaysBody)(map, numCols, numRows, originX, originY, firstAngle, angleStep, rays, numRays, tileShift); \
+} \
+KERNEL_TARGET \
+static void KERNEL(drawWalls_##tag)(const struct Ray* rays, int numRays, float cameraAngle, uint32_t* buffer, int width, int height, \
+                                    const uint32_t* const* textures, struct ColumnInfo* columns) { \
+    KERNEL(drawWallsBody)(rays, numRays, cameraAngle, buffer, width, height, textures, columns, tileShift, textureWidthShift, textureHeightShift); \
+} \
+KERNEL_TARGET \
+static void KERNEL(drawIndexedWalls_##tag)(const struct Ray* rays, int numRays, float cameraAngle, uint8_t* buffer, int width, int height, \
+                                           const uint8_t* const* textures, struct ColumnInfo* columns) { \
+    KERNEL(drawIndexedWallsBody)(rays, numRays, cameraAngle, buffer, width, height, textures, columns, tileShift, textureWidthShift, textureHeightShift); \
+}
+
+DEFINE_SIZED_KERNELS(generic, 0, 0, 0)
+DEFINE_SIZED_KERNELS(sized, TILE_SHIFT, TEXTURE_WIDTH_SHIFT, TEXTURE_HEIGHT_SHIFT)
+
+//The variant for the sizes this build was compiled with, then the generic fallback.
+static const struct KernelVariant KERNEL(variants)[] = {
+    { SIZED_VARIANT_NAME, KERNEL(castRays_sized), KERNEL(drawWalls_sized), KERNEL(drawIndexedWalls_sized) },
+    { "generic", KERNEL(castRays_generic), KERNEL(drawWalls_generic), KERNEL(drawIndexedWalls_generic) }
+};
+
+#undef DEFINE_SIZED_KERNELS
@@ -0,0 +1,81 @@
+//
+//  latency.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "latency.h"
+
+//Inputs drained but not yet shown. More than this in one frame is only possible
+//with a flood of events; the extra ones go unmeasured.
+#define MAX_PENDING_INPUTS 64
+
+//Event timestamps are in SDL_GetTicks() milliseconds, so the time an event spent
+//queued is measured in ticks and the rest of the path with the performance counter.
+static uint32_t pendingQueuedUs[MAX_PENDING_INPUTS];
+static Uint64 pendingDrainCounter[MAX_PENDING_INPUTS];
+static int numPending = 0;
+
+static uint32_t histogram[LATENCY_NUM_BUCKETS];
+static uint32_t numSamples = 0;
+static double totalUs = 0;
+static uint32_t worstUs = 0;
+
+void markInputEvent(uint32_t eventTimestamp) {
+    if(numPending == MAX_PENDING_INPUTS) {
+        return;
+    }
+    Uint32 ticks = SDL_GetTicks();
+    pendingQueuedUs[numPending] = ticks > eventTimestamp ? (ticks - eventTimestamp) * 1000 : 0;
+    pendingDrainCounter[numPending] = SDL_GetPerformanceCounter();
+    numPending++;
+}
+
+void markFramePresented(void) {
+    if(numPending == 0) {
+        return;
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    for(int i = 0; i < numPending; i++) {
+        uint32_t latencyUs = pendingQueuedUs[i] + (uint32_t)((now - pendingDrainCounter[i]) * 1000000 / frequency);
+        int bucket = latencyUs / LATENCY_BUCKET_US;
+        histogram[bucket < LATENCY_NUM_BUCKETS ? bucket : LATENCY_NUM_BUCKETS - 1]++;
+        numSamples++;
+        totalUs += latencyUs;
+        if(latencyUs > worstUs) {
+            worstUs = latencyUs;
+        }
+    }
+    numPending = 0;
+}
+
+//Upper edge of the bucket holding the given fraction of samples, in milliseconds,
+//capped at the worst sample.
+static double percentile(double fraction) {
+    uint32_t target = (uint32_t)(fraction * numSamples);
+    uint32_t seen = 0;
+    uint32_t edgeUs = worstUs;
+    for(int i = 0; i < LATENCY_NUM_BUCKETS - 1; i++) {
+        seen += histogram[i];
+        if(seen > target) {
+            edgeUs = (i + 1) * LATENCY_BUCKET_US;
+            break;
+        }
+    }
+    return (edgeUs < worstUs ? edgeUs : worstUs) / 1000.0;
+}
+
+void reportLatency(void) {
+    if(numSamples == 0) {
+        printf("Input latency: no input events \n");
+        return;
+    }
+    printf("Input latency over %u events: mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms \n",
+           numSamples, totalUs / numSamples / 1000.0, percentile(0.5), percentile(0.95), percentile(0.99),
+           worstUs / 1000.0);
+}
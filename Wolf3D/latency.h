@@ -0,0 +1,28 @@
+//
+//  latency.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef latency_h
+#define latency_h
+
+#include <stdint.h>
+
+//Histogram resolution and range. Anything slower lands in the last bucket.
+#define LATENCY_BUCKET_US 250
+#define LATENCY_NUM_BUCKETS 400
+
+//Call for each input event as it is drained, with the event's SDL timestamp.
+void markInputEvent(uint32_t eventTimestamp);
+
+//Call right after SDL_RenderPresent(). Every input marked since the last present
+//becomes one input-to-present sample.
+void markFramePresented(void);
+
+//Prints the sample count, mean, percentiles and worst case.
+void reportLatency(void);
+
+#endif /* latency_h */
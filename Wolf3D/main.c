@@ -9,8 +9,18 @@
 #include <stdio.h>
 #include <SDL2/SDL.h>
 #include "constants.h"
-#include "textures.h"
-#include <limits.h>
+#include "engine.h"
+#include "capture.h"
+#include "batch.h"
+#include "latency.h"
+#include "demo.h"
+#include "mapgen.h"
+#include "snapshot.h"
+#include "validate.h"
+#include "flowfield.h"
+#include "entities.h"
+#include "pvs.h"
+#include <string.h>
 
 const int map[MAP_NUM_ROWS][MAP_NUM_COLS] = {
     {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 ,1, 1, 1, 1, 1, 1, 1},
@@ -28,36 +38,32 @@ const int map[MAP_NUM_ROWS][MAP_NUM_COLS] = {
     {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 5, 5, 5, 5, 5, 5}
 };
 
-struct Player {
-    float x;
-    float y;
-    float width;
-    float height;
-    int turnDirection; //-1: left, 1:right
-    int walkDirection; //-1: back, 1:front
-    float rotationAngle;
-    float walkSpeed;
-    float turnSpeed;
-} player;
-
-struct Ray {
-    float rayAngle;
-    float wallHitX;
-    float wallHitY;
-    int wasHitVertical;
-    float distance;
-    int isRayFacingUp;
-    int isRayFacingDown;
-    int isRayFacingLeft;
-    int isRayFacingRight;
-    int wallHitContent;
-} rays[NUM_RAYS];
+struct World world;
+struct RenderContext context;
+struct FlowField flowField;
+struct EntityStore entities;
+struct ThreadPool* entityPool = NULL;
+SDL_Point* entityPoints = NULL;
+int numEntities = 0;
+struct Pvs pvs;
+struct PvsView playerView;
+int isPvsBuilt = FALSE;
+int pvsBuildFrames = 0;
+double pvsBuildMs = 0;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
-Uint32* colorBuffer = NULL;
 SDL_Texture* colorBufferTexture = NULL;
-Uint32* textures[NUM_TEXTURES];
+int useIndexedColor = FALSE;
+const char* capturePath = NULL;
+enum CaptureFormat captureFormat = CAPTURE_RAW;
+int measureLatency = FALSE;
+const char* demoRecordPath = NULL;
+const char* demoPlayPath = NULL;
+int isTimedemo = FALSE;
+struct Demo demo;
+struct StateHistory history;
+int isRewinding = FALSE;
 int isGameRunning = FALSE;
 int ticksLastFrame;
 
@@ -90,26 +96,49 @@ int initializeWindow() {
 }
 
 void destroyWindow() {
-    free(colorBuffer);
+    free(entityPoints);
+    destroyThreadPool(entityPool);
+    destroyEntityStore(&entities);
+    destroyPvs(&pvs);
+    destroyFlowField(&flowField);
+    destroyRenderContext(&context);
+    destroyWorld(&world);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
 void setup() {
-    //TODO: initialize and set up game objects
-    player.x = WINDOW_WIDTH/2;
-    player.y = WINDOW_HEIGHT/2;
-    player.width = 5;
-    player.height = 5;
-    player.turnDirection = 0;
-    player.walkDirection = 0;
-    player.rotationAngle = PI/2;
-    player.walkSpeed = 100;
-    player.turnSpeed = 45 * (PI/180);
+    initWorld(&world, &map[0][0], MAP_NUM_COLS, MAP_NUM_ROWS);
+    if(useIndexedColor) {
+        useIndexedColor = buildIndexedTextures(&world);
+    }
     
     //Allocate the frame buffer
-    colorBuffer = (Uint32*) malloc(sizeof(Uint32) * (Uint32)(WINDOW_WIDTH * WINDOW_HEIGHT));
+    if(!createRenderContext(&context, &world, WINDOW_WIDTH, WINDOW_HEIGHT, NULL, useIndexedColor)) {
+        fprintf(stderr, "Error allocating the render context \n");
+        isGameRunning = FALSE;
+    }
+    if(!createFlowField(&flowField, world.map, world.numCols, world.numRows)) {
+        fprintf(stderr, "Error allocating the flow field \n");
+        isGameRunning = FALSE;
+    }
+    if(numEntities > 0) {
+        //Only entity sight reads the PVS. It is built for PVS_MS_PER_FRAME each frame;
+        //until a cell is built it sees everything, so nothing is culled wrongly meanwhile.
+        if(!createPvs(&pvs, world.map, world.numCols, world.numRows)) {
+            fprintf(stderr, "Error allocating the visibility sets \n");
+            isGameRunning = FALSE;
+        }
+        if(createEntityStore(&entities, &world, numEntities)) {
+            spawnEntities(&entities, &world, numEntities, 1);
+            entityPool = createThreadPool(0);
+            entityPoints = (SDL_Point*) malloc(sizeof(SDL_Point) * (size_t)numEntities);
+        }
+        else {
+            fprintf(stderr, "Error allocating %d entities \n", numEntities);
+        }
+    }
     colorBufferTexture =SDL_CreateTexture(
                                           renderer,
                                           SDL_PIXELFORMAT_ARGB8888,
@@ -117,43 +146,10 @@ void setup() {
                                           WINDOW_WIDTH,
                                           WINDOW_HEIGHT
                                           );
-    //Load textures from textures.h
-    textures[0] = (Uint32*) REDBRICK_TEXTURE;
-    textures[1] = (Uint32*) PURPLESTONE_TEXTURE;
-    textures[2] = (Uint32*) MOSSYSTONE_TEXTURE;
-    textures[3] = (Uint32*) GRAYSTONE_TEXTURE;
-    textures[4] = (Uint32*) COLORSTONE_TEXTURE;
-    textures[5] = (Uint32*) BLUESTONE_TEXTURE;
-    textures[6] = (Uint32*) WOOD_TEXTURE;
-    textures[7] = (Uint32*) EAGLE_TEXTURE;
-    
-}
-
-int mapHasWallAt(float x, float y) {
-    if(x < 0 || x > WINDOW_WIDTH || y < 0 || y > WINDOW_HEIGHT) {
-        return TRUE;
-    }
-    int _x = floor(x/TILE_SIZE);
-    int _y = floor(y/TILE_SIZE);
-    return map[_y][_x] != 0;
-}
-
-void movePlayer(float deltaTime) {
-    player.rotationAngle += player.turnDirection * player.turnSpeed * deltaTime;
-    int moveStep = player.walkDirection * player.walkSpeed * deltaTime;
-    float newX = player.x + cos(player.rotationAngle) * moveStep;
-    float newY = player.y + sin(player.rotationAngle) * moveStep;
-    
-    //Wall collision.
-    if(!mapHasWallAt(newX, newY)) {
-        player.x = newX;
-        player.y = newY;
-    }
-    
-    
 }
 
 void renderPlayer() {
+    struct Player player = context.state.player;
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
     SDL_Rect playerRect = {
         player.x * MINIMAP_SCALE_FACTOR,
@@ -172,161 +168,12 @@ void renderPlayer() {
      );
 }
 
-float normalizeAngle(float angle) {
-    angle = remainderf(angle, TWO_PI);
-    if(angle < 0) {
-        angle += TWO_PI;
-    }
-    return angle;
-}
-
-float distanceBetweenPoints(float x1, float y1, float x2, float y2) {
-    return sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
-}
-
-void castRay(float rayAngle, int stripId) {
-    rayAngle = normalizeAngle(rayAngle);
-    
-    int isRayFacingDown = rayAngle > 0 && rayAngle < PI;
-    int isRayFacingUp = !isRayFacingDown;
-    
-    int isRayFacingRight = rayAngle < 0.5 * PI || rayAngle > 1.5 * PI;
-    int isRayFacingLeft = !isRayFacingRight;
-    
-    float xintercept, yintercept;
-    float xstep, ystep;
-    
-    ///////////////////////////////////////////
-    // HORIZONTAL RAY-GRID INTERSECTION CODE
-    ///////////////////////////////////////////
-    int foundHorzWallHit = FALSE;
-    float horzWallHitX = 0;
-    float horzWallHitY = 0;
-    int horzWallContent = 0;
-    
-    // Find the y-coordinate of the closest horizontal grid intersection
-    yintercept = floor(player.y / TILE_SIZE) * TILE_SIZE;
-    yintercept += isRayFacingDown ? TILE_SIZE : 0;
-    
-    // Find the x-coordinate of the closest horizontal grid intersection
-    xintercept = player.x + (yintercept - player.y) / tan(rayAngle);
-    
-    // Calculate the increment xstep and ystep
-    ystep = TILE_SIZE;
-    ystep *= isRayFacingUp ? -1 : 1;
-    
-    xstep = TILE_SIZE / tan(rayAngle);
-    xstep *= (isRayFacingLeft && xstep > 0) ? -1 : 1;
-    xstep *= (isRayFacingRight && xstep < 0) ? -1 : 1;
-    
-    float nextHorzTouchX = xintercept;
-    float nextHorzTouchY = yintercept;
-    
-    // Increment xstep and ystep until we find a wall
-    while (nextHorzTouchX >= 0 && nextHorzTouchX <= WINDOW_WIDTH && nextHorzTouchY >= 0 && nextHorzTouchY <= WINDOW_HEIGHT) {
-        float xToCheck = nextHorzTouchX;
-        float yToCheck = nextHorzTouchY + (isRayFacingUp ? -1 : 0);
-        
-        if (mapHasWallAt(xToCheck, yToCheck)) {
-            // found a wall hit
-            horzWallHitX = nextHorzTouchX;
-            horzWallHitY = nextHorzTouchY;
-            horzWallContent = map[(int)floor(yToCheck / TILE_SIZE)][(int)floor(xToCheck / TILE_SIZE)];
-            foundHorzWallHit = TRUE;
-            break;
-        } else {
-            nextHorzTouchX += xstep;
-            nextHorzTouchY += ystep;
-        }
-    }
-    
-    ///////////////////////////////////////////
-    // VERTICAL RAY-GRID INTERSECTION CODE
-    ///////////////////////////////////////////
-    int foundVertWallHit = FALSE;
-    float vertWallHitX = 0;
-    float vertWallHitY = 0;
-    int vertWallContent = 0;
-    
-    // Find the x-coordinate of the closest horizontal grid intersection
-    xintercept = floor(player.x / TILE_SIZE) * TILE_SIZE;
-    xintercept += isRayFacingRight ? TILE_SIZE : 0;
-    
-    // Find the y-coordinate of the closest horizontal grid intersection
-    yintercept = player.y + (xintercept - player.x) * tan(rayAngle);
-    
-    // Calculate the increment xstep and ystep
-    xstep = TILE_SIZE;
-    xstep *= isRayFacingLeft ? -1 : 1;
-    
-    ystep = TILE_SIZE * tan(rayAngle);
-    ystep *= (isRayFacingUp && ystep > 0) ? -1 : 1;
-    ystep *= (isRayFacingDown && ystep < 0) ? -1 : 1;
-    
-    float nextVertTouchX = xintercept;
-    float nextVertTouchY = yintercept;
-    
-    // Increment xstep and ystep until we find a wall
-    while (nextVertTouchX >= 0 && nextVertTouchX <= WINDOW_WIDTH && nextVertTouchY >= 0 && nextVertTouchY <= WINDOW_HEIGHT) {
-        float xToCheck = nextVertTouchX + (isRayFacingLeft ? -1 : 0);
-        float yToCheck = nextVertTouchY;
-        
-        if (mapHasWallAt(xToCheck, yToCheck)) {
-            // found a wall hit
-            vertWallHitX = nextVertTouchX;
-            vertWallHitY = nextVertTouchY;
-            vertWallContent = map[(int)floor(yToCheck / TILE_SIZE)][(int)floor(xToCheck / TILE_SIZE)];
-            foundVertWallHit = TRUE;
-            break;
-        } else {
-            nextVertTouchX += xstep;
-            nextVertTouchY += ystep;
-        }
-    }
-    
-    // Calculate both horizontal and vertical hit distances and choose the smallest one
-    float horzHitDistance = foundHorzWallHit
-    ? distanceBetweenPoints(player.x, player.y, horzWallHitX, horzWallHitY)
-    : INT_MAX;
-    float vertHitDistance = foundVertWallHit
-    ? distanceBetweenPoints(player.x, player.y, vertWallHitX, vertWallHitY)
-    : INT_MAX;
-    
-    if (vertHitDistance < horzHitDistance) {
-        rays[stripId].distance = vertHitDistance;
-        rays[stripId].wallHitX = vertWallHitX;
-        rays[stripId].wallHitY = vertWallHitY;
-        rays[stripId].wallHitContent = vertWallContent;
-        rays[stripId].wasHitVertical = TRUE;
-    } else {
-        rays[stripId].distance = horzHitDistance;
-        rays[stripId].wallHitX = horzWallHitX;
-        rays[stripId].wallHitY = horzWallHitY;
-        rays[stripId].wallHitContent = horzWallContent;
-        rays[stripId].wasHitVertical = FALSE;
-    }
-    rays[stripId].rayAngle = rayAngle;
-    rays[stripId].isRayFacingDown = isRayFacingDown;
-    rays[stripId].isRayFacingUp = isRayFacingUp;
-    rays[stripId].isRayFacingLeft = isRayFacingLeft;
-    rays[stripId].isRayFacingRight = isRayFacingRight;
-}
-
-void castAllRays() {
-    //Start first ray subtracting half of our FOV
-    float rayAngle = player.rotationAngle - (FOV_ANGLE/2);
-    for(int stripId = 0; stripId < NUM_RAYS; stripId++) {
-        castRay(rayAngle,stripId);
-        rayAngle += FOV_ANGLE / NUM_RAYS;
-    }
-}
-
 void renderMap() {
-    for(int i = 0 ; i < MAP_NUM_ROWS; i++) {
-        for(int j = 0; j < MAP_NUM_COLS; j++) {
+    for(int i = 0 ; i < world.numRows; i++) {
+        for(int j = 0; j < world.numCols; j++) {
             int tileX = j * TILE_SIZE;
             int tileY = i * TILE_SIZE;
-            int tileColor = map[i][j] != 0 ? 255 : 0;
+            int tileColor = world.map[i * world.numCols + j] != 0 ? 255 : 0;
             SDL_SetRenderDrawColor(renderer, tileColor, tileColor, tileColor, 255);
             SDL_Rect mapTileRect = {
                 tileX * MINIMAP_SCALE_FACTOR,
@@ -341,55 +188,62 @@ void renderMap() {
 
 void renderRays() {
     SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-    for(int i = 0; i < NUM_RAYS; i++) {
+    for(int i = 0; i < context.numRays; i++) {
         SDL_RenderDrawLine(renderer,
-                           MINIMAP_SCALE_FACTOR * player.x,
-                           MINIMAP_SCALE_FACTOR * player.y,
-                           MINIMAP_SCALE_FACTOR * rays[i].wallHitX,
-                           MINIMAP_SCALE_FACTOR * rays[i].wallHitY
+                           MINIMAP_SCALE_FACTOR * context.state.player.x,
+                           MINIMAP_SCALE_FACTOR * context.state.player.y,
+                           MINIMAP_SCALE_FACTOR * context.rays[i].wallHitX,
+                           MINIMAP_SCALE_FACTOR * context.rays[i].wallHitY
                            );
     }
 }
 
-void processInput() {
-    SDL_Event event;
-    SDL_PollEvent(&event);
-    switch(event.type) {
+void handleEvent(const SDL_Event* event) {
+    if(measureLatency && (event->type == SDL_KEYDOWN || event->type == SDL_KEYUP) && !event->key.repeat) {
+        markInputEvent(event->common.timestamp);
+    }
+    switch(event->type) {
         case SDL_QUIT:
         {
             isGameRunning = FALSE;
             break;
         }
         case SDL_KEYDOWN:{
-            if(event.key.keysym.sym == SDLK_ESCAPE) {
+            if(event->key.keysym.sym == SDLK_ESCAPE) {
                 isGameRunning = FALSE;
             }
-            if(event.key.keysym.sym == SDLK_UP) {
-                player.walkDirection = 1;
+            if(event->key.keysym.sym == SDLK_BACKSPACE) {
+                isRewinding = TRUE;
             }
-            if(event.key.keysym.sym == SDLK_DOWN) {
-                player.walkDirection = -1;
+            if(event->key.keysym.sym == SDLK_UP) {
+                context.state.player.walkDirection = 1;
             }
-            if(event.key.keysym.sym == SDLK_LEFT) {
-                player.turnDirection  = -1;
+            if(event->key.keysym.sym == SDLK_DOWN) {
+                context.state.player.walkDirection = -1;
             }
-            if(event.key.keysym.sym == SDLK_RIGHT) {
-                player.turnDirection = 1;
+            if(event->key.keysym.sym == SDLK_LEFT) {
+                context.state.player.turnDirection  = -1;
+            }
+            if(event->key.keysym.sym == SDLK_RIGHT) {
+                context.state.player.turnDirection = 1;
             }
             break;
         }
         case SDL_KEYUP: {
-            if(event.key.keysym.sym == SDLK_UP) {
-                player.walkDirection = 0;
+            if(event->key.keysym.sym == SDLK_BACKSPACE) {
+                isRewinding = FALSE;
+            }
+            if(event->key.keysym.sym == SDLK_UP) {
+                context.state.player.walkDirection = 0;
             }
-            if(event.key.keysym.sym == SDLK_DOWN) {
-                player.walkDirection = 0;
+            if(event->key.keysym.sym == SDLK_DOWN) {
+                context.state.player.walkDirection = 0;
             }
-            if(event.key.keysym.sym == SDLK_LEFT) {
-                player.turnDirection  = 0;
+            if(event->key.keysym.sym == SDLK_LEFT) {
+                context.state.player.turnDirection  = 0;
             }
-            if(event.key.keysym.sym == SDLK_RIGHT) {
-                player.turnDirection = 0;
+            if(event->key.keysym.sym == SDLK_RIGHT) {
+                context.state.player.turnDirection = 0;
             }
             break;
         }
@@ -398,71 +252,98 @@ void processInput() {
     }
 }
 
-void update() {
+void renderEntities() {
+    if(!entityPoints) {
+        return;
+    }
+    //Entities that can see the player go first, in red, the rest after them in yellow.
+    int numVisible = 0;
+    int numHidden = 0;
+    for(int i = 0; i < entities.count; i++) {
+        int slot = entities.canSeeTarget[i] ? numVisible++ : entities.count - 1 - numHidden++;
+        entityPoints[slot].x = entities.x[i] * MINIMAP_SCALE_FACTOR;
+        entityPoints[slot].y = entities.y[i] * MINIMAP_SCALE_FACTOR;
+    }
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    SDL_RenderDrawPoints(renderer, entityPoints, numVisible);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    SDL_RenderDrawPoints(renderer, entityPoints + numVisible, numHidden);
+}
+
+void processInput() {
+    SDL_Event event;
+    //Drain the whole queue so events that arrived together take effect in the same frame.
+    while(SDL_PollEvent(&event)) {
+        handleEvent(&event);
+    }
+}
+
+//Sleeps off the rest of the frame before input is read, not after, so the
+//inputs a frame acts on are as fresh as possible when it is presented.
+void waitForNextFrame() {
     int timeToWait = FRAME_TIME_LENGTH - (SDL_GetTicks() - ticksLastFrame);
     if(timeToWait > 0 && timeToWait <=FRAME_TIME_LENGTH) {
         SDL_Delay(timeToWait);
     }
-    float deltaTime = (SDL_GetTicks() - ticksLastFrame)/1000.0f;
-    ticksLastFrame = SDL_GetTicks();
-    movePlayer(deltaTime);
-    castAllRays();
-    
 }
 
-void generate3DProjection() {
-    for(int i = 0; i < NUM_RAYS; i++) {
-        float distanceProjPlane = (WINDOW_WIDTH) / 2 / tan(FOV_ANGLE/2);
-        float perpDistance = rays[i].distance * cos(rays[i].rayAngle - player.rotationAngle);
-        float projectedWallHeight = (TILE_SIZE/perpDistance) * distanceProjPlane;
-        int wallStripHeight = (int) projectedWallHeight;
-        
-        int wallTopPixel = (WINDOW_HEIGHT/2) - (wallStripHeight/2);
-        wallTopPixel = wallTopPixel < 0 ? 0 : wallTopPixel;
-        
-        int wallBottomPixel = (WINDOW_HEIGHT/2) + (wallStripHeight/2);
-        wallBottomPixel = wallBottomPixel > WINDOW_HEIGHT ? WINDOW_HEIGHT : wallBottomPixel;
-        
-        for(int y = 0; y < wallTopPixel; y++)
-            colorBuffer[(WINDOW_WIDTH)*y + i] = 0xff333333;
-        
-        //Calculate X offset.
-        int textureOffsetX;
-        if(rays[i].wasHitVertical) {
-            textureOffsetX = (int)rays[i].wallHitY % TILE_SIZE;
-        }
-        else {
-            textureOffsetX = (int)rays[i].wallHitX % TILE_SIZE;
-        }
-        
-        
-        for(int y = wallTopPixel; y < wallBottomPixel; y++) {
-            //TODO: Calculate texture Offset Y.
-            int distanceFromTop = (y + (wallStripHeight/2) - (WINDOW_HEIGHT/2));
-            int textureOffsetY = distanceFromTop * ((float)TEXTURE_HEIGHT/wallStripHeight);
-            int texNum = rays[i].wallHitContent-1;
-            Uint32 texelColor = textures[texNum][(TEXTURE_WIDTH * textureOffsetY) + textureOffsetX];
-            colorBuffer[WINDOW_WIDTH * y + i] = texelColor;
+void update() {
+    Uint32 ticks = SDL_GetTicks();
+    Uint32 deltaMs = ticks - ticksLastFrame;
+    ticksLastFrame = ticks;
+    //A demo overrides both the keys and the clock, so playback moves exactly as recorded.
+    if(demoPlayPath) {
+        deltaMs = playDemoTick(&demo, &context.state.player);
+    }
+    else if(demoRecordPath) {
+        recordDemoTick(context.state.player.walkDirection, context.state.player.turnDirection, deltaMs);
+    }
+    float deltaTime = deltaMs/1000.0f;
+    //Holding backspace steps back one saved frame per frame. Demos always run forward.
+    //So do entities: their store lives outside WorldState, and copying every entity
+    //into each of the STATE_HISTORY_SIZE saved frames would cost O(N) per frame and
+    //megabytes of history, so rewinding the player alone would leave them out of step.
+    if(isRewinding && !demoPlayPath && !demoRecordPath && entities.count == 0) {
+        struct WorldState previous;
+        if(popState(&history, &previous)) {
+            //Keep the keys as they are held now, not as they were back then.
+            previous.player.walkDirection = context.state.player.walkDirection;
+            previous.player.turnDirection = context.state.player.turnDirection;
+            restoreState(&context, &previous);
         }
-        
-        for(int y = wallBottomPixel; y < WINDOW_HEIGHT; y++)
-            colorBuffer[WINDOW_WIDTH*y + i] = 0xff777777;
+        castAllRays(&context);
+        return;
     }
-}
-
-void clearColorBuffer(Uint32 color) {
-    for(int i = 0; i < WINDOW_WIDTH; i++) {
-        for(int j = 0; j < WINDOW_HEIGHT; j++) {
-            colorBuffer[(j * WINDOW_WIDTH) + i] = color;
+    pushState(&history, &context.state);
+    movePlayer(&context, deltaTime);
+    setFlowTarget(&flowField, context.state.player.x, context.state.player.y);
+    updateFlowField(&flowField, FLOW_FIELD_TILES_PER_FRAME);
+    updateEntities(&entities, &world, &flowField, context.state.player.x, context.state.player.y, deltaTime, entityPool);
+    if(pvs.cells) {
+        Uint64 pvsStart = SDL_GetPerformanceCounter();
+        int isPvsCurrent = updatePvs(&pvs, PVS_MS_PER_FRAME);
+        if(!isPvsBuilt) {
+            pvsBuildFrames++;
+            pvsBuildMs += (double)(SDL_GetPerformanceCounter() - pvsStart) * 1000.0 / SDL_GetPerformanceFrequency();
+            if(isPvsCurrent) {
+                isPvsBuilt = TRUE;
+                printf("Visibility sets built over %d frames, %.0f ms of work, %zu KB \n",
+                       pvsBuildFrames, pvsBuildMs, pvsMemoryUsage(&pvs) / 1024);
+            }
         }
+        loadPvsView(&pvs, context.state.player.x, context.state.player.y, &playerView);
     }
+    checkEntitySight(&entities, &world, pvs.cells ? &playerView : NULL, context.state.player.x, context.state.player.y, entityPool);
+    castAllRays(&context);
+    
 }
 
 void renderColorBuffer() {
+    resolveColorBuffer(&context);
     SDL_UpdateTexture(
                       colorBufferTexture,
                       NULL,
-                      colorBuffer,
+                      context.colorBuffer,
                       (int)((Uint32) WINDOW_WIDTH * sizeof(Uint32))
                       );
     SDL_RenderCopy(renderer, colorBufferTexture, NULL, NULL);
@@ -473,25 +354,250 @@ void render() {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
     
-    generate3DProjection();
+    generate3DProjection(&context);
     
     renderColorBuffer();
-    clearColorBuffer(0xff000000);
+    if(capturePath) {
+        captureFrame(context.colorBuffer, ticksLastFrame);
+    }
+    if(context.useIndexedColor) {
+        clearIndexedBuffer(&context, BLACK_INDEX);
+    }
+    else {
+        clearColorBuffer(&context, 0xff000000);
+    }
     
     renderMap();
     renderRays();
+    renderEntities();
     renderPlayer();
     
     SDL_RenderPresent(renderer);
+    if(measureLatency) {
+        markFramePresented();
+    }
+}
+
+void reportTimedemo(double* frameMs, int numFrames, double seconds) {
+    struct FrameStats stats;
+    computeFrameStats(frameMs, numFrames, &stats);
+    printf("Timedemo: %d frames in %.3f s, %.1f fps \n", numFrames, seconds, numFrames / seconds);
+    printf("Frame time: average %.3f ms, 1%% low %.3f ms, 0.1%% low %.3f ms, worst %.3f ms \n",
+           stats.averageMs, stats.onePercentLowMs, stats.pointOnePercentLowMs, stats.worstMs);
+}
+
+//Headless throughput check for the batch API: random actions, small observations.
+void runBatchBenchmark(int numEnvs) {
+    const int numSteps = 1000;
+    struct EnvBatch batch;
+    initWorld(&world, &map[0][0], MAP_NUM_COLS, MAP_NUM_ROWS);
+    if(!createEnvBatch(&batch, &world, numEnvs, BATCH_OBSERVATION_WIDTH, BATCH_OBSERVATION_HEIGHT, 1.0f / FPS, 0)) {
+        fprintf(stderr, "Error creating a batch of %d environments \n", numEnvs);
+        return;
+    }
+    Sint8* walkDirections = (Sint8*) malloc(sizeof(Sint8) * (size_t)numEnvs);
+    Sint8* turnDirections = (Sint8*) malloc(sizeof(Sint8) * (size_t)numEnvs);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(int step = 0; step < numSteps; step++) {
+        for(int i = 0; i < numEnvs; i++) {
+            walkDirections[i] = (Sint8)(rand() % 3 - 1);
+            turnDirections[i] = (Sint8)(rand() % 3 - 1);
+        }
+        stepEnvBatch(&batch, walkDirections, turnDirections);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d environments x %d steps at %dx%d on %d threads: %.0f observations/s \n",
+           numEnvs, numSteps, BATCH_OBSERVATION_WIDTH, BATCH_OBSERVATION_HEIGHT, threadPoolSize(batch.pool),
+           numEnvs * numSteps / seconds);
+    free(walkDirections);
+    free(turnDirections);
+    destroyEnvBatch(&batch);
+    destroyWorld(&world);
+}
+
+//Times ray casting and wall drawing separately over generated maps of every class,
+//doubling the side length up to maxSize, along the same seeded camera paths each run.
+void runStressBenchmark(int maxSize) {
+    const int numPoses = 128;
+    struct CameraPose* poses = (struct CameraPose*) malloc(sizeof(struct CameraPose) * numPoses);
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    printf("%-14s %6s %12s %12s \n", "map", "size", "cast ms", "project ms");
+    for(int mapClass = 0; mapClass < NUM_MAP_CLASSES; mapClass++) {
+        for(int size = 16; size <= maxSize; size *= 2) {
+            struct GeneratedMap generated;
+            struct World stressWorld;
+            struct RenderContext stressContext;
+            if(!generateMap(&generated, mapClass, size, size, 1234 + size)) {
+                fprintf(stderr, "Error generating a %dx%d map \n", size, size);
+                continue;
+            }
+            initWorld(&stressWorld, generated.tiles, generated.numCols, generated.numRows);
+            if(!generateCameraPath(&generated, 5678 + size, poses, numPoses)
+               || !createRenderContext(&stressContext, &stressWorld, WINDOW_WIDTH, WINDOW_HEIGHT, NULL, FALSE)) {
+                freeGeneratedMap(&generated);
+                continue;
+            }
+            Uint64 castTicks = 0;
+            Uint64 projectTicks = 0;
+            for(int i = 0; i < numPoses; i++) {
+                resetPlayer(&stressContext.state.player, poses[i].x, poses[i].y, poses[i].rotationAngle);
+                Uint64 start = SDL_GetPerformanceCounter();
+                castAllRays(&stressContext);
+                Uint64 cast = SDL_GetPerformanceCounter();
+                generate3DProjection(&stressContext);
+                projectTicks += SDL_GetPerformanceCounter() - cast;
+                castTicks += cast - start;
+            }
+            printf("%-14s %6d %12.3f %12.3f \n", mapClassName(mapClass), size,
+                   castTicks * 1000.0 / frequency / numPoses, projectTicks * 1000.0 / frequency / numPoses);
+            destroyRenderContext(&stressContext);
+            destroyWorld(&stressWorld);
+            freeGeneratedMap(&generated);
+        }
+    }
+    free(poses);
+}
+
+//Checks every kernel set against the reference, and the PVS against traced sight
+//lines, on the built-in map and on a few generated ones. Returns the process exit code.
+int runValidation(int numPoses) {
+    static const enum MapClass mapClasses[] = { MAP_MAZE, MAP_CORRIDORS, MAP_PILLAR_FOREST };
+    int isValid = TRUE;
+    printf("Built-in map, %d poses \n", numPoses);
+    initWorld(&world, &map[0][0], MAP_NUM_COLS, MAP_NUM_ROWS);
+    buildIndexedTextures(&world);
+    isValid = validateKernels(&world, numPoses, 1) && isValid;
+    isValid = validatePvs(&world, numPoses * 10, 1) && isValid;
+    for(int i = 0; i < (int)(sizeof(mapClasses) / sizeof(mapClasses[0])); i++) {
+        struct GeneratedMap generated;
+        if(!generateMap(&generated, mapClasses[i], 65, 65, 42 + i)) {
+            continue;
+        }
+        printf("Generated %s, %d poses \n", mapClassName(mapClasses[i]), numPoses);
+        world.map = generated.tiles;
+        world.numCols = generated.numCols;
+        world.numRows = generated.numRows;
+        isValid = validateKernels(&world, numPoses, 7 + i) && isValid;
+        isValid = validatePvs(&world, numPoses * 10, 7 + i) && isValid;
+        freeGeneratedMap(&generated);
+    }
+    destroyWorld(&world);
+    printf("%s \n", isValid ? "All kernels and visibility sets match the reference" : "Kernels or visibility sets differ from the reference");
+    return isValid ? 0 : 1;
 }
 
 int main(int argc, const char * argv[]) {
+    const char* forcedIsa = getenv("WOLF3D_ISA");
+    int batchBenchmarkEnvs = 0;
+    int stressBenchmarkSize = 0;
+    int validationPoses = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-indexed") == 0) {
+            useIndexedColor = TRUE;
+        }
+        else if(strcmp(argv[i], "-isa") == 0 && i + 1 < argc) {
+            forcedIsa = argv[++i];
+        }
+        else if(strcmp(argv[i], "-capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+            captureFormat = CAPTURE_RAW;
+        }
+        else if(strcmp(argv[i], "-captureppm") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+            captureFormat = CAPTURE_PPM;
+        }
+        else if(strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+            demoRecordPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-playdemo") == 0 && i + 1 < argc) {
+            demoPlayPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-timedemo") == 0 && i + 1 < argc) {
+            demoPlayPath = argv[++i];
+            isTimedemo = TRUE;
+        }
+        else if(strcmp(argv[i], "-entities") == 0 && i + 1 < argc) {
+            numEntities = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-latency") == 0) {
+            measureLatency = TRUE;
+        }
+        else if(strcmp(argv[i], "-stressbench") == 0) {
+            stressBenchmarkSize = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 4096;
+        }
+        else if(strcmp(argv[i], "-validate") == 0) {
+            validationPoses = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 10000;
+        }
+        else if(strcmp(argv[i], "-batchbench") == 0 && i + 1 < argc) {
+            batchBenchmarkEnvs = atoi(argv[++i]);
+        }
+    }
+    selectRenderKernels(forcedIsa);
+    printf("Using %s render kernels (%s) \n", kernels.name, kernels.variant);
+    if(batchBenchmarkEnvs > 0) {
+        runBatchBenchmark(batchBenchmarkEnvs);
+        return 0;
+    }
+    if(validationPoses > 0) {
+        return runValidation(validationPoses);
+    }
+    if(stressBenchmarkSize > 0) {
+        runStressBenchmark(stressBenchmarkSize);
+        return 0;
+    }
     isGameRunning = initializeWindow();
     setup();
+    if(capturePath && !startFrameCapture(capturePath, captureFormat, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        capturePath = NULL;
+    }
+    if(demoPlayPath) {
+        if(loadDemo(&demo, demoPlayPath)) {
+            rewindDemo(&demo, &context.state.player);
+            demoRecordPath = NULL;
+        }
+        else {
+            demoPlayPath = NULL;
+            isTimedemo = FALSE;
+        }
+    }
+    if(demoRecordPath && !startDemoRecording(demoRecordPath, &context.state.player)) {
+        demoRecordPath = NULL;
+    }
+    double* frameMs = isTimedemo ? (double*) malloc(sizeof(double) * (size_t)(demo.numTicks ? demo.numTicks : 1)) : NULL;
+    int numFrames = 0;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 timedemoStart = SDL_GetPerformanceCounter();
+    clearStateHistory(&history);
+    ticksLastFrame = SDL_GetTicks();
     while(isGameRunning) {
+        if(demoPlayPath && isDemoFinished(&demo)) {
+            break;
+        }
+        //The timedemo runs uncapped: frame times measure the renderer, not the sleep.
+        if(!isTimedemo) {
+            waitForNextFrame();
+        }
+        Uint64 frameStart = SDL_GetPerformanceCounter();
         processInput();
         update();
         render();
+        if(frameMs) {
+            frameMs[numFrames++] = (double)(SDL_GetPerformanceCounter() - frameStart) * 1000.0 / frequency;
+        }
+    }
+    if(frameMs) {
+        reportTimedemo(frameMs, numFrames, (double)(SDL_GetPerformanceCounter() - timedemoStart) / frequency);
+        free(frameMs);
+    }
+    if(demoRecordPath) {
+        stopDemoRecording();
+    }
+    freeDemo(&demo);
+    if(capturePath) {
+        stopFrameCapture();
+    }
+    if(measureLatency) {
+        reportLatency();
     }
     destroyWindow();
     return 0;
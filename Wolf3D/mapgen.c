@@ -0,0 +1,194 @@
+//
+//  mapgen.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/31/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "constants.h"
+#include "mapgen.h"
+
+#define MIN_MAP_SIZE 5
+#define CORRIDOR_SPACING 4      //Rows per hall, including its wall
+#define DOOR_CHANCE 0.02f
+#define PILLAR_DENSITY 0.08f
+#define CAMERA_STEP (TILE_SIZE / 4.0f)
+#define CAMERA_TURN (PI / 32)
+
+uint32_t nextRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+float nextRandomFloat(uint32_t* state) {
+    return (nextRandom(state) >> 8) / 16777216.0f;
+}
+
+const char* mapClassName(enum MapClass mapClass) {
+    static const char* names[NUM_MAP_CLASSES] = { "maze", "open field", "corridors", "pillar forest" };
+    return mapClass < NUM_MAP_CLASSES ? names[mapClass] : "unknown";
+}
+
+static int randomWall(uint32_t* state) {
+    return 1 + (int)(nextRandom(state) % NUM_TEXTURES);
+}
+
+static void addBorder(struct GeneratedMap* map, uint32_t* state) {
+    for(int x = 0; x < map->numCols; x++) {
+        map->tiles[x] = randomWall(state);
+        map->tiles[(map->numRows - 1) * map->numCols + x] = randomWall(state);
+    }
+    for(int y = 0; y < map->numRows; y++) {
+        map->tiles[y * map->numCols] = randomWall(state);
+        map->tiles[y * map->numCols + map->numCols - 1] = randomWall(state);
+    }
+}
+
+//Iterative backtracker over the odd cells, so even the largest mazes don't recurse.
+static int carveMaze(struct GeneratedMap* map, uint32_t* state) {
+    static const int directions[4][2] = { {2, 0}, {-2, 0}, {0, 2}, {0, -2} };
+    int numCols = map->numCols;
+    for(int i = 0; i < numCols * map->numRows; i++) {
+        map->tiles[i] = randomWall(state);
+    }
+    int cellsX = (numCols - 1) / 2;
+    int cellsY = (map->numRows - 1) / 2;
+    int* stack = (int*) malloc(sizeof(int) * (size_t)cellsX * cellsY);
+    if(!stack) {
+        return FALSE;
+    }
+    int depth = 0;
+    stack[depth++] = 1 * numCols + 1;
+    map->tiles[1 * numCols + 1] = 0;
+    while(depth > 0) {
+        int cell = stack[depth - 1];
+        int x = cell % numCols;
+        int y = cell / numCols;
+        int options[4];
+        int numOptions = 0;
+        for(int d = 0; d < 4; d++) {
+            int nx = x + directions[d][0];
+            int ny = y + directions[d][1];
+            if(nx > 0 && nx < numCols - 1 && ny > 0 && ny < map->numRows - 1 && map->tiles[ny * numCols + nx] != 0) {
+                options[numOptions++] = d;
+            }
+        }
+        if(numOptions == 0) {
+            depth--;
+            continue;
+        }
+        int d = options[nextRandom(state) % numOptions];
+        int nx = x + directions[d][0];
+        int ny = y + directions[d][1];
+        map->tiles[(y + directions[d][1] / 2) * numCols + x + directions[d][0] / 2] = 0;
+        map->tiles[ny * numCols + nx] = 0;
+        stack[depth++] = ny * numCols + nx;
+    }
+    free(stack);
+    return TRUE;
+}
+
+static void buildCorridors(struct GeneratedMap* map, uint32_t* state) {
+    for(int y = CORRIDOR_SPACING; y < map->numRows - 1; y += CORRIDOR_SPACING) {
+        //At least one door per wall keeps every hall reachable.
+        int door = 1 + (int)(nextRandom(state) % (map->numCols - 2));
+        for(int x = 1; x < map->numCols - 1; x++) {
+            if(x != door && nextRandomFloat(state) >= DOOR_CHANCE) {
+                map->tiles[y * map->numCols + x] = randomWall(state);
+            }
+        }
+    }
+}
+
+static void plantPillars(struct GeneratedMap* map, uint32_t* state) {
+    for(int y = 1; y < map->numRows - 1; y++) {
+        for(int x = 1; x < map->numCols - 1; x++) {
+            if(nextRandomFloat(state) < PILLAR_DENSITY) {
+                map->tiles[y * map->numCols + x] = randomWall(state);
+            }
+        }
+    }
+}
+
+int generateMap(struct GeneratedMap* map, enum MapClass mapClass, int numCols, int numRows, uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    map->numCols = numCols > MIN_MAP_SIZE ? numCols : MIN_MAP_SIZE;
+    map->numRows = numRows > MIN_MAP_SIZE ? numRows : MIN_MAP_SIZE;
+    map->tiles = (int*) calloc((size_t)map->numCols * map->numRows, sizeof(int));
+    if(!map->tiles) {
+        return FALSE;
+    }
+    switch(mapClass) {
+        case MAP_MAZE:
+            if(!carveMaze(map, &state)) {
+                freeGeneratedMap(map);
+                return FALSE;
+            }
+            break;
+        case MAP_CORRIDORS:
+            buildCorridors(map, &state);
+            break;
+        case MAP_PILLAR_FOREST:
+            plantPillars(map, &state);
+            break;
+        default:
+            break;
+    }
+    addBorder(map, &state);
+    return TRUE;
+}
+
+void freeGeneratedMap(struct GeneratedMap* map) {
+    free(map->tiles);
+    map->tiles = NULL;
+}
+
+static int isOpen(const struct GeneratedMap* map, float x, float y) {
+    int tileX = (int)floorf(x / TILE_SIZE);
+    int tileY = (int)floorf(y / TILE_SIZE);
+    if(tileX < 0 || tileX >= map->numCols || tileY < 0 || tileY >= map->numRows) {
+        return FALSE;
+    }
+    return map->tiles[tileY * map->numCols + tileX] == 0;
+}
+
+int generateCameraPath(const struct GeneratedMap* map, uint32_t seed, struct CameraPose* poses, int numPoses) {
+    uint32_t state = seed ? seed : 1;
+    int numTiles = map->numCols * map->numRows;
+    int start = (int)(nextRandom(&state) % numTiles);
+    int tile = start;
+    while(map->tiles[tile] != 0) {
+        tile = (tile + 1) % numTiles;
+        if(tile == start) {
+            return FALSE;
+        }
+    }
+    float x = (tile % map->numCols + 0.5f) * TILE_SIZE;
+    float y = (tile / map->numCols + 0.5f) * TILE_SIZE;
+    float angle = nextRandomFloat(&state) * TWO_PI;
+    for(int i = 0; i < numPoses; i++) {
+        poses[i].x = x;
+        poses[i].y = y;
+        poses[i].rotationAngle = angle;
+
+        angle += (nextRandomFloat(&state) - 0.5f) * CAMERA_TURN;
+        float newX = x + cosf(angle) * CAMERA_STEP;
+        float newY = y + sinf(angle) * CAMERA_STEP;
+        if(isOpen(map, newX, newY)) {
+            x = newX;
+            y = newY;
+        }
+        else {
+            //Blocked: turn somewhere between a quarter and three quarters around.
+            angle += PI / 2 + nextRandomFloat(&state) * PI;
+        }
+    }
+    return TRUE;
+}
@@ -0,0 +1,50 @@
+//
+//  mapgen.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/31/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef mapgen_h
+#define mapgen_h
+
+#include <stdint.h>
+
+enum MapClass {
+    MAP_MAZE,           //One-tile corridors, every wall a turn away
+    MAP_OPEN_FIELD,     //Only the border, so rays cross the whole map
+    MAP_CORRIDORS,      //Long parallel halls joined by occasional doors
+    MAP_PILLAR_FOREST,  //Scattered single-tile pillars
+    NUM_MAP_CLASSES
+};
+
+//Row-major tiles like the built-in map, walls 1..NUM_TEXTURES, always closed by a border.
+struct GeneratedMap {
+    int* tiles;
+    int numCols;
+    int numRows;
+};
+
+struct CameraPose {
+    float x;
+    float y;
+    float rotationAngle;
+};
+
+//xorshift32. The state must not be zero.
+uint32_t nextRandom(uint32_t* state);
+//Uniform in [0, 1).
+float nextRandomFloat(uint32_t* state);
+
+const char* mapClassName(enum MapClass mapClass);
+
+//The same class, size and seed always give the same map. Sizes below 5 are raised to 5.
+int generateMap(struct GeneratedMap* map, enum MapClass mapClass, int numCols, int numRows, uint32_t seed);
+void freeGeneratedMap(struct GeneratedMap* map);
+
+//A continuous walk through empty tiles, turning away from walls, like a player would.
+//Returns FALSE if the map has no empty tile to start from.
+int generateCameraPath(const struct GeneratedMap* map, uint32_t seed, struct CameraPose* poses, int numPoses);
+
+#endif /* mapgen_h */
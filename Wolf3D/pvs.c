@@ -0,0 +1,476 @@
+//
+//  pvs.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/3/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "constants.h"
+#include "pvs.h"
+
+//Sight lines are tested exactly, so a cell is hidden only if no segment from anywhere
+//in the center cell to anywhere in it keeps clear of the walls. The test works in a
+//frame turned and mirrored so that the far cell is at (n, m) with 0 <= m <= n, where a
+//line is fixed by its heights u at x = 1 and v at x = n. Keeping clear of a wall bounds
+//(u, v) by a half-plane, so the lines through one gap per column form a convex
+//polygon; the search picks gaps column by column until some polygon survives.
+#define MAX_POLYGON_VERTICES 96
+//Lines may graze walls by this much, in tiles, so rounding in the float traces the
+//sets stand in for can't make those see a cell the set hides.
+#define SIGHT_SLACK 1e-3
+//Traces tried before the search run between the same point of both cells, in tile
+//units: the center and four points just inside the corners.
+#define NUM_SAMPLE_POINTS 5
+static const float samplePoints[NUM_SAMPLE_POINTS][2] = {
+    {0.5f, 0.5f}, {0.01f, 0.01f}, {0.99f, 0.01f}, {0.01f, 0.99f}, {0.99f, 0.99f}
+};
+
+struct SightFrame {
+    const struct Pvs* pvs;
+    int centerCol;
+    int centerRow;
+    int colPerX;        //Map offsets of one step along the frame's axes
+    int rowPerX;
+    int colPerY;
+    int rowPerY;
+    int n;
+    int m;
+};
+
+//Lines that may still be clear, as (u, v) points of a convex polygon.
+struct SightPolygon {
+    int numVertices;
+    double u[MAX_POLYGON_VERTICES];
+    double v[MAX_POLYGON_VERTICES];
+};
+
+int createPvs(struct Pvs* pvs, const int* map, int numCols, int numRows) {
+    int numCells = numCols * numRows;
+    pvs->map = map;
+    pvs->numCols = numCols;
+    pvs->numRows = numRows;
+    pvs->dirtyHead = 0;
+    pvs->numDirty = 0;
+    pvs->buildingCell = -1;
+    pvs->buildingDistance = 0;
+    pvs->cells = (struct PvsCell*) calloc((size_t)numCells, sizeof(struct PvsCell));
+    pvs->dirtyCells = (int*) malloc(sizeof(int) * (size_t)numCells);
+    if(!pvs->cells || !pvs->dirtyCells) {
+        destroyPvs(pvs);
+        return FALSE;
+    }
+    for(int cell = 0; cell < numCells; cell++) {
+        if(map[cell] == 0) {
+            pvs->cells[cell].isDirty = TRUE;
+            pvs->dirtyCells[pvs->numDirty++] = cell;
+        }
+    }
+    return TRUE;
+}
+
+void destroyPvs(struct Pvs* pvs) {
+    if(pvs->cells) {
+        for(int cell = 0; cell < pvs->numCols * pvs->numRows; cell++) {
+            free(pvs->cells[cell].runs);
+        }
+    }
+    free(pvs->cells);
+    free(pvs->dirtyCells);
+    pvs->cells = NULL;
+    pvs->dirtyCells = NULL;
+    pvs->numDirty = 0;
+    pvs->buildingCell = -1;
+}
+
+void invalidatePvsTile(struct Pvs* pvs, int col, int row) {
+    //A set half built from the old map starts over.
+    if(pvs->buildingCell >= 0 && abs(pvs->buildingCell % pvs->numCols - col) <= PVS_MAX_DISTANCE
+       && abs(pvs->buildingCell / pvs->numCols - row) <= PVS_MAX_DISTANCE) {
+        pvs->buildingDistance = 0;
+    }
+    for(int r = row - PVS_MAX_DISTANCE; r <= row + PVS_MAX_DISTANCE; r++) {
+        for(int c = col - PVS_MAX_DISTANCE; c <= col + PVS_MAX_DISTANCE; c++) {
+            if(c < 0 || c >= pvs->numCols || r < 0 || r >= pvs->numRows) {
+                continue;
+            }
+            int cell = r * pvs->numCols + c;
+            //Walls are queued too if they still hold a set from when they were empty.
+            if((pvs->map[cell] == 0 || pvs->cells[cell].runs) && !pvs->cells[cell].isDirty) {
+                pvs->cells[cell].isDirty = TRUE;
+                pvs->dirtyCells[(pvs->dirtyHead + pvs->numDirty++) % (pvs->numCols * pvs->numRows)] = cell;
+            }
+        }
+    }
+}
+
+//Grid walk from (x0, y0) to (x1, y1), in tile units. TRUE if every cell crossed before
+//the one holding the end point is empty.
+static int isSightLineClear(const struct Pvs* pvs, float x0, float y0, float x1, float y1) {
+    int col = (int)x0;
+    int row = (int)y0;
+    int endCol = (int)x1;
+    int endRow = (int)y1;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    int stepCol = dx > 0 ? 1 : -1;
+    int stepRow = dy > 0 ? 1 : -1;
+    float deltaX = dx != 0 ? fabsf(1 / dx) : INFINITY;
+    float deltaY = dy != 0 ? fabsf(1 / dy) : INFINITY;
+    float nextX = dx != 0 ? (stepCol > 0 ? col + 1 - x0 : x0 - col) * deltaX : INFINITY;
+    float nextY = dy != 0 ? (stepRow > 0 ? row + 1 - y0 : y0 - row) * deltaY : INFINITY;
+    while(col != endCol || row != endRow) {
+        if(nextX < nextY) {
+            col += stepCol;
+            nextX += deltaX;
+        }
+        else {
+            row += stepRow;
+            nextY += deltaY;
+        }
+        if(col == endCol && row == endRow) {
+            break;
+        }
+        if(col < 0 || col >= pvs->numCols || row < 0 || row >= pvs->numRows || pvs->map[row * pvs->numCols + col] != 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+//The center and far cells count as open, the far one even when it is a wall, since
+//what matters is whether a sight line reaches it.
+static int isFrameTileOpen(const struct SightFrame* frame, int x, int y) {
+    if((x == 0 && y == 0) || (x == frame->n && y == frame->m)) {
+        return TRUE;
+    }
+    const struct Pvs* pvs = frame->pvs;
+    int col = frame->centerCol + x * frame->colPerX + y * frame->colPerY;
+    int row = frame->centerRow + x * frame->rowPerX + y * frame->rowPerY;
+    return col >= 0 && col < pvs->numCols && row >= 0 && row < pvs->numRows && pvs->map[row * pvs->numCols + col] == 0;
+}
+
+static void copyPolygon(struct SightPolygon* to, const struct SightPolygon* from) {
+    to->numVertices = from->numVertices;
+    memcpy(to->u, from->u, sizeof(double) * (size_t)from->numVertices);
+    memcpy(to->v, from->v, sizeof(double) * (size_t)from->numVertices);
+}
+
+//Keeps the part of the polygon where a * u + b * v + c >= 0. A cut that would overflow
+//the polygon is skipped, which only lets more lines through.
+static void clipPolygon(struct SightPolygon* polygon, double a, double b, double c) {
+    int isInside = TRUE;
+    for(int i = 0; i < polygon->numVertices && isInside; i++) {
+        isInside = a * polygon->u[i] + b * polygon->v[i] + c >= 0;
+    }
+    if(isInside) {
+        return;
+    }
+    struct SightPolygon clipped;
+    clipped.numVertices = 0;
+    int count = polygon->numVertices;
+    for(int i = 0; i < count; i++) {
+        int j = i + 1 < count ? i + 1 : 0;
+        double side = a * polygon->u[i] + b * polygon->v[i] + c;
+        double nextSide = a * polygon->u[j] + b * polygon->v[j] + c;
+        if(clipped.numVertices + 2 > MAX_POLYGON_VERTICES) {
+            return;
+        }
+        if(side >= 0) {
+            clipped.u[clipped.numVertices] = polygon->u[i];
+            clipped.v[clipped.numVertices++] = polygon->v[i];
+        }
+        if((side >= 0) != (nextSide >= 0)) {
+            double t = side / (side - nextSide);
+            clipped.u[clipped.numVertices] = polygon->u[i] + t * (polygon->u[j] - polygon->u[i]);
+            clipped.v[clipped.numVertices++] = polygon->v[i] + t * (polygon->v[j] - polygon->v[i]);
+        }
+    }
+    copyPolygon(polygon, &clipped);
+}
+
+//The line's height at x is ((n - x) * u + (x - 1) * v) / (n - 1).
+static void keepHeightAtLeast(const struct SightFrame* frame, struct SightPolygon* polygon, int x, double height) {
+    clipPolygon(polygon, frame->n - x, x - 1, -(frame->n - 1) * (height - SIGHT_SLACK));
+}
+
+static void keepHeightAtMost(const struct SightFrame* frame, struct SightPolygon* polygon, int x, double height) {
+    clipPolygon(polygon, x - frame->n, 1 - x, (frame->n - 1) * (height + SIGHT_SLACK));
+}
+
+//TRUE if some line of the polygon crosses columns x to n - 1 through open tiles only.
+static int searchColumns(const struct SightFrame* frame, const struct SightPolygon* polygon, int x) {
+    if(x == frame->n) {
+        return TRUE;
+    }
+    double lowest = INFINITY;
+    double highest = -INFINITY;
+    for(int i = 0; i < polygon->numVertices; i++) {
+        for(int edge = x; edge <= x + 1; edge++) {
+            double height = ((frame->n - edge) * polygon->u[i] + (edge - 1) * polygon->v[i]) / (frame->n - 1);
+            lowest = height < lowest ? height : lowest;
+            highest = height > highest ? height : highest;
+        }
+    }
+    int first = (int)floor(lowest) > 0 ? (int)floor(lowest) : 0;
+    int last = (int)floor(highest) < frame->m ? (int)floor(highest) : frame->m;
+    for(int y = first; y <= last; y++) {
+        if(!isFrameTileOpen(frame, x, y)) {
+            continue;
+        }
+        int gapLow = y;
+        while(gapLow > 0 && isFrameTileOpen(frame, x, gapLow - 1)) {
+            gapLow--;
+        }
+        while(y < frame->m && isFrameTileOpen(frame, x, y + 1)) {
+            y++;
+        }
+        struct SightPolygon clipped;
+        copyPolygon(&clipped, polygon);
+        keepHeightAtLeast(frame, &clipped, x, gapLow);
+        keepHeightAtMost(frame, &clipped, x, y + 1);
+        keepHeightAtLeast(frame, &clipped, x + 1, gapLow);
+        keepHeightAtMost(frame, &clipped, x + 1, y + 1);
+        if(clipped.numVertices > 0 && searchColumns(frame, &clipped, x + 1)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static int canSeeCell(const struct Pvs* pvs, int centerCol, int centerRow, int c, int r) {
+    if(abs(c) <= 1 && abs(r) <= 1) {
+        return TRUE;
+    }
+    //A few traces find most visible cells far faster than the search.
+    for(int i = 0; i < NUM_SAMPLE_POINTS; i++) {
+        if(isSightLineClear(pvs, centerCol + samplePoints[i][0], centerRow + samplePoints[i][1],
+                            centerCol + c + samplePoints[i][0], centerRow + r + samplePoints[i][1])) {
+            return TRUE;
+        }
+    }
+    int stepCol = c < 0 ? -1 : 1;
+    int stepRow = r < 0 ? -1 : 1;
+    int isSteep = abs(r) > abs(c);
+    struct SightFrame frame = {
+        pvs, centerCol, centerRow,
+        isSteep ? 0 : stepCol, isSteep ? stepRow : 0,
+        isSteep ? stepCol : 0, isSteep ? 0 : stepRow,
+        isSteep ? abs(r) : abs(c), isSteep ? abs(c) : abs(r)
+    };
+    //The line leaves the center cell through its gap of column 0 and enters the far
+    //cell through its gap of column n.
+    int startHigh = 0;
+    while(startHigh < frame.m && isFrameTileOpen(&frame, 0, startHigh + 1)) {
+        startHigh++;
+    }
+    int endLow = frame.m;
+    while(endLow > 0 && isFrameTileOpen(&frame, frame.n, endLow - 1)) {
+        endLow--;
+    }
+    //Rising and falling lines meet the two cells' squares under different conditions,
+    //each linear on its own.
+    for(int isRising = 0; isRising <= 1; isRising++) {
+        struct SightPolygon polygon = {
+            4,
+            { -SIGHT_SLACK, startHigh + 1 + SIGHT_SLACK, startHigh + 1 + SIGHT_SLACK, -SIGHT_SLACK },
+            { endLow - SIGHT_SLACK, endLow - SIGHT_SLACK, frame.m + 1 + SIGHT_SLACK, frame.m + 1 + SIGHT_SLACK }
+        };
+        if(isRising) {
+            clipPolygon(&polygon, -1, 1, 0);
+            keepHeightAtMost(&frame, &polygon, 0, 1);
+            keepHeightAtLeast(&frame, &polygon, frame.n + 1, frame.m);
+        }
+        else {
+            clipPolygon(&polygon, 1, -1, 0);
+            keepHeightAtMost(&frame, &polygon, 1, 1);
+            keepHeightAtLeast(&frame, &polygon, 0, 0);
+            keepHeightAtLeast(&frame, &polygon, frame.n, frame.m);
+            keepHeightAtMost(&frame, &polygon, frame.n + 1, frame.m + 1);
+        }
+        if(polygon.numVertices > 0 && searchColumns(&frame, &polygon, 1)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//A sight line enters a cell from one of its neighbors toward the center, so only
+//cells with such a neighbor that is open and visible are tested.
+static int hasVisiblePredecessor(const struct Pvs* pvs, int centerCol, int centerRow, int c, int r) {
+    int stepCol = c > 0 ? 1 : (c < 0 ? -1 : 0);
+    int stepRow = r > 0 ? 1 : (r < 0 ? -1 : 0);
+    for(int i = 0; i < 3; i++) {
+        int pc = c - (i != 1 ? stepCol : 0);
+        int pr = r - (i != 0 ? stepRow : 0);
+        if(pc == c && pr == r) {
+            continue;
+        }
+        int windowIndex = (pr + PVS_MAX_DISTANCE) * PVS_WINDOW_SIZE + pc + PVS_MAX_DISTANCE;
+        if(pvs->scratchVisible[windowIndex] && pvs->map[(centerRow + pr) * pvs->numCols + centerCol + pc] == 0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void testWindowCell(struct Pvs* pvs, int centerCol, int centerRow, int c, int r) {
+    int col = centerCol + c;
+    int row = centerRow + r;
+    int isVisible = col >= 0 && col < pvs->numCols && row >= 0 && row < pvs->numRows
+    && hasVisiblePredecessor(pvs, centerCol, centerRow, c, r)
+    && canSeeCell(pvs, centerCol, centerRow, c, r);
+    pvs->scratchVisible[(r + PVS_MAX_DISTANCE) * PVS_WINDOW_SIZE + c + PVS_MAX_DISTANCE] = (uint8_t)isVisible;
+}
+
+static int isOpenAndVisible(const struct Pvs* pvs, int centerCol, int centerRow, int c, int r) {
+    int col = centerCol + c;
+    int row = centerRow + r;
+    return col >= 0 && col < pvs->numCols && row >= 0 && row < pvs->numRows
+    && pvs->map[row * pvs->numCols + col] == 0
+    && pvs->scratchVisible[(r + PVS_MAX_DISTANCE) * PVS_WINDOW_SIZE + c + PVS_MAX_DISTANCE];
+}
+
+//Tests the cells this many steps along the axes from the center. Going outward this
+//way, a cell's neighbors toward the center are always done before it.
+static void testWindowDistance(struct Pvs* pvs, int centerCol, int centerRow, int distance) {
+    for(int c = -PVS_MAX_DISTANCE; c <= PVS_MAX_DISTANCE; c++) {
+        int r = distance - abs(c);
+        if(r < 0 || r > PVS_MAX_DISTANCE) {
+            continue;
+        }
+        testWindowCell(pvs, centerCol, centerRow, c, r);
+        if(r > 0) {
+            testWindowCell(pvs, centerCol, centerRow, c, -r);
+        }
+    }
+}
+
+static void finishCell(struct Pvs* pvs, int cell) {
+    int centerCol = cell % pvs->numCols;
+    int centerRow = cell / pvs->numCols;
+    uint16_t* runs = pvs->scratchRuns;
+    int numRuns = 0;
+    int runIsVisible = FALSE;
+    int runLength = 0;
+    for(int i = 0; i < PVS_WINDOW_SIZE * PVS_WINDOW_SIZE; i++) {
+        if(pvs->scratchVisible[i] != runIsVisible) {
+            runs[numRuns++] = (uint16_t)runLength;
+            runIsVisible = pvs->scratchVisible[i];
+            runLength = 0;
+        }
+        runLength++;
+    }
+    runs[numRuns++] = (uint16_t)runLength;
+
+    //A sight line that leaves the window has to cross an empty visible cell of the last ring.
+    int seesPastWindow = FALSE;
+    for(int i = -PVS_MAX_DISTANCE; i <= PVS_MAX_DISTANCE && !seesPastWindow; i++) {
+        seesPastWindow = isOpenAndVisible(pvs, centerCol, centerRow, i, -PVS_MAX_DISTANCE)
+        || isOpenAndVisible(pvs, centerCol, centerRow, i, PVS_MAX_DISTANCE)
+        || isOpenAndVisible(pvs, centerCol, centerRow, -PVS_MAX_DISTANCE, i)
+        || isOpenAndVisible(pvs, centerCol, centerRow, PVS_MAX_DISTANCE, i);
+    }
+
+    struct PvsCell* pvsCell = &pvs->cells[cell];
+    uint16_t* stored = (uint16_t*) realloc(pvsCell->runs, sizeof(uint16_t) * (size_t)numRuns);
+    if(stored) {
+        memcpy(stored, runs, sizeof(uint16_t) * (size_t)numRuns);
+        pvsCell->runs = stored;
+        pvsCell->numRuns = (uint16_t)numRuns;
+        pvsCell->seesPastWindow = (uint8_t)seesPastWindow;
+    }
+    pvsCell->isDirty = FALSE;
+}
+
+//Advances the cell being built by one step: clearing its window, testing one distance,
+//or storing the result.
+static void stepBuild(struct Pvs* pvs) {
+    int cell = pvs->buildingCell;
+    int distance = pvs->buildingDistance;
+    if(distance == 0 && pvs->map[cell] != 0) {
+        //A wall placed since the cell was queued has no set of its own.
+        free(pvs->cells[cell].runs);
+        pvs->cells[cell].runs = NULL;
+        pvs->cells[cell].numRuns = 0;
+        pvs->cells[cell].isDirty = FALSE;
+        pvs->buildingCell = -1;
+    }
+    else if(distance == 0) {
+        memset(pvs->scratchVisible, FALSE, sizeof(pvs->scratchVisible));
+        pvs->scratchVisible[PVS_MAX_DISTANCE * PVS_WINDOW_SIZE + PVS_MAX_DISTANCE] = TRUE;
+        pvs->buildingDistance++;
+    }
+    else if(distance <= 2 * PVS_MAX_DISTANCE) {
+        testWindowDistance(pvs, cell % pvs->numCols, cell / pvs->numCols, distance);
+        pvs->buildingDistance++;
+    }
+    else {
+        finishCell(pvs, cell);
+        pvs->buildingCell = -1;
+    }
+}
+
+int updatePvs(struct Pvs* pvs, double maxMs) {
+    Uint64 deadline = SDL_GetPerformanceCounter() + (Uint64)(maxMs * SDL_GetPerformanceFrequency() / 1000);
+    int numCells = pvs->numCols * pvs->numRows;
+    do {
+        if(pvs->buildingCell < 0) {
+            if(pvs->numDirty == 0) {
+                break;
+            }
+            //Oldest first, so a steady stream of changes can't starve early ones.
+            pvs->buildingCell = pvs->dirtyCells[pvs->dirtyHead];
+            pvs->buildingDistance = 0;
+            pvs->dirtyHead = (pvs->dirtyHead + 1) % numCells;
+            pvs->numDirty--;
+        }
+        stepBuild(pvs);
+    } while(SDL_GetPerformanceCounter() < deadline);
+    return pvs->numDirty == 0 && pvs->buildingCell < 0;
+}
+
+size_t pvsMemoryUsage(const struct Pvs* pvs) {
+    size_t bytes = 0;
+    for(int cell = 0; cell < pvs->numCols * pvs->numRows; cell++) {
+        bytes += sizeof(uint16_t) * pvs->cells[cell].numRuns;
+    }
+    return bytes;
+}
+
+void loadPvsView(const struct Pvs* pvs, float x, float y, struct PvsView* view) {
+    view->centerCol = (int)floorf(x / TILE_SIZE);
+    view->centerRow = (int)floorf(y / TILE_SIZE);
+    int isInside = view->centerCol >= 0 && view->centerCol < pvs->numCols && view->centerRow >= 0 && view->centerRow < pvs->numRows;
+    const struct PvsCell* cell = isInside ? &pvs->cells[view->centerRow * pvs->numCols + view->centerCol] : NULL;
+    if(!cell || !cell->runs) {
+        memset(view->isVisible, TRUE, sizeof(view->isVisible));
+        view->seesPastWindow = TRUE;
+        return;
+    }
+    view->seesPastWindow = cell->seesPastWindow;
+    uint8_t* flag = view->isVisible;
+    for(int i = 0; i < cell->numRuns; i++) {
+        memset(flag, i & 1, cell->runs[i]);
+        flag += cell->runs[i];
+    }
+}
+
+int pvsViewCovers(const struct PvsView* view, float x, float y) {
+    int c = (int)floorf(x / TILE_SIZE) - view->centerCol + PVS_MAX_DISTANCE;
+    int r = (int)floorf(y / TILE_SIZE) - view->centerRow + PVS_MAX_DISTANCE;
+    return c >= 0 && c < PVS_WINDOW_SIZE && r >= 0 && r < PVS_WINDOW_SIZE;
+}
+
+int pvsViewCanSee(const struct PvsView* view, float x, float y) {
+    if(!pvsViewCovers(view, x, y)) {
+        return view->seesPastWindow;
+    }
+    int c = (int)floorf(x / TILE_SIZE) - view->centerCol + PVS_MAX_DISTANCE;
+    int r = (int)floorf(y / TILE_SIZE) - view->centerRow + PVS_MAX_DISTANCE;
+    return view->isVisible[r * PVS_WINDOW_SIZE + c];
+}
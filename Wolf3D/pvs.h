@@ -0,0 +1,83 @@
+//
+//  pvs.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/3/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef pvs_h
+#define pvs_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Sets cover cells up to this many tiles away along either axis. Cells further out
+//count as visible whenever a set's outermost ring has an empty visible cell.
+#define PVS_MAX_DISTANCE 32
+#define PVS_WINDOW_SIZE (2 * PVS_MAX_DISTANCE + 1)
+//Time spent per frame recomputing dirty cells. A cell costs from a few microseconds in
+//mazes to several milliseconds in pillar forests, so a fixed count of cells can't bound
+//a frame; building is split into steps of one distance from the cell and stopped on time.
+#define PVS_MS_PER_FRAME 2.0
+
+//Visibility from one empty cell over the window of cells around it, row by row, as
+//alternating run lengths of hidden and visible cells, starting with hidden. A cell is
+//hidden only if no sight line from anywhere in the empty cell reaches any part of it.
+struct PvsCell {
+    uint16_t* runs;
+    uint16_t numRuns;
+    uint8_t isDirty;
+    uint8_t seesPastWindow;     //Some sight line leaves the window, so cells beyond it may be visible
+};
+
+//Potentially visible sets for every empty cell of a map.
+struct Pvs {
+    const int* map;
+    int numCols;
+    int numRows;
+    struct PvsCell* cells;
+    int* dirtyCells;        //Ring of numCols * numRows; a cell is queued at most once
+    int dirtyHead;
+    int numDirty;
+    int buildingCell;       //Dirty cell whose set is part built, or -1
+    int buildingDistance;   //Its next step: 0 clears the window, 1 to 2 * PVS_MAX_DISTANCE test cells that far
+    uint8_t scratchVisible[PVS_WINDOW_SIZE * PVS_WINDOW_SIZE];
+    uint16_t scratchRuns[PVS_WINDOW_SIZE * PVS_WINDOW_SIZE + 1];
+};
+
+//One cell's set expanded into plain flags for O(1) lookups, e.g. once per frame for
+//the player's cell.
+struct PvsView {
+    int centerCol;
+    int centerRow;
+    int seesPastWindow;
+    uint8_t isVisible[PVS_WINDOW_SIZE * PVS_WINDOW_SIZE];
+};
+
+//Allocates the sets and marks every empty cell dirty; updatePvs() computes them.
+int createPvs(struct Pvs* pvs, const int* map, int numCols, int numRows);
+void destroyPvs(struct Pvs* pvs);
+
+//Call after changing the tile at (col, row): every empty cell that could see past it
+//is queued for recomputation.
+void invalidatePvsTile(struct Pvs* pvs, int col, int row);
+
+//Recomputes dirty cells for about maxMs milliseconds, always making some progress.
+//Returns TRUE when none are left. Until then dirty cells keep answering with their
+//old sets.
+int updatePvs(struct Pvs* pvs, double maxMs);
+
+//Bytes held by the compressed sets.
+size_t pvsMemoryUsage(const struct Pvs* pvs);
+
+//Expands the set of the cell holding world position (x, y). A wall cell, or one whose
+//set hasn't been computed yet, sees everything in its window.
+void loadPvsView(const struct Pvs* pvs, float x, float y, struct PvsView* view);
+//TRUE if world position (x, y) is potentially visible from the view's cell. Positions
+//beyond the window count as visible unless no sight line leaves the window.
+int pvsViewCanSee(const struct PvsView* view, float x, float y);
+//TRUE if world position (x, y) lies inside the view's window, where its flags are exact.
+int pvsViewCovers(const struct PvsView* view, float x, float y);
+
+#endif /* pvs_h */
@@ -0,0 +1,71 @@
+//
+//  snapshot.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/1/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <string.h>
+#include "snapshot.h"
+
+//memcmp-based comparison is only sound while the struct has no padding.
+_Static_assert(sizeof(struct Player) == 9 * 4, "struct Player has padding");
+_Static_assert(sizeof(struct WorldState) == sizeof(struct Player) + 8, "struct WorldState has padding");
+
+void snapshotState(const struct RenderContext* context, struct WorldState* snapshot) {
+    *snapshot = context->state;
+}
+
+void restoreState(struct RenderContext* context, const struct WorldState* snapshot) {
+    context->state = *snapshot;
+}
+
+int statesEqual(const struct WorldState* a, const struct WorldState* b) {
+    return memcmp(a, b, sizeof(struct WorldState)) == 0;
+}
+
+#define DIFF_FIELD(field, format) \
+    if(memcmp(&a->field, &b->field, sizeof(a->field)) != 0) { \
+        fprintf(file, "  %-22s " format " != " format "\n", #field, a->field, b->field); \
+        numDifferences++; \
+    }
+
+int printStateDiff(FILE* file, const struct WorldState* a, const struct WorldState* b) {
+    int numDifferences = 0;
+    DIFF_FIELD(player.x, "%.9g")
+    DIFF_FIELD(player.y, "%.9g")
+    DIFF_FIELD(player.width, "%.9g")
+    DIFF_FIELD(player.height, "%.9g")
+    DIFF_FIELD(player.turnDirection, "%d")
+    DIFF_FIELD(player.walkDirection, "%d")
+    DIFF_FIELD(player.rotationAngle, "%.9g")
+    DIFF_FIELD(player.walkSpeed, "%.9g")
+    DIFF_FIELD(player.turnSpeed, "%.9g")
+    DIFF_FIELD(tick, "%u")
+    DIFF_FIELD(time, "%.9g")
+    return numDifferences;
+}
+
+void clearStateHistory(struct StateHistory* history) {
+    history->newest = -1;
+    history->count = 0;
+}
+
+void pushState(struct StateHistory* history, const struct WorldState* state) {
+    history->newest = (history->newest + 1) % STATE_HISTORY_SIZE;
+    history->states[history->newest] = *state;
+    if(history->count < STATE_HISTORY_SIZE) {
+        history->count++;
+    }
+}
+
+int popState(struct StateHistory* history, struct WorldState* state) {
+    if(history->count == 0) {
+        return FALSE;
+    }
+    *state = history->states[history->newest];
+    history->newest = (history->newest + STATE_HISTORY_SIZE - 1) % STATE_HISTORY_SIZE;
+    history->count--;
+    return TRUE;
+}
@@ -0,0 +1,40 @@
+//
+//  snapshot.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/1/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef snapshot_h
+#define snapshot_h
+
+#include <stdio.h>
+#include "engine.h"
+
+//About 17 seconds of rewind at the default frame rate.
+#define STATE_HISTORY_SIZE 512
+
+//Fixed ring of recent states. Only WorldState is saved, never the EntityStore:
+//copying every entity into each saved frame would cost O(N) per frame, so callers
+//must not rewind while entities are alive or the two would drift out of step.
+//Pushing onto a full ring drops the oldest one.
+struct StateHistory {
+    struct WorldState states[STATE_HISTORY_SIZE];
+    int newest;
+    int count;
+};
+
+void snapshotState(const struct RenderContext* context, struct WorldState* snapshot);
+void restoreState(struct RenderContext* context, const struct WorldState* snapshot);
+//TRUE if the two states are bit-identical.
+int statesEqual(const struct WorldState* a, const struct WorldState* b);
+//Prints every field that differs, for chasing desyncs. Returns how many did.
+int printStateDiff(FILE* file, const struct WorldState* a, const struct WorldState* b);
+
+void clearStateHistory(struct StateHistory* history);
+void pushState(struct StateHistory* history, const struct WorldState* state);
+//Removes the newest state into *state. Returns FALSE when the history is empty.
+int popState(struct StateHistory* history, struct WorldState* state);
+
+#endif /* snapshot_h */
@@ -0,0 +1,148 @@
+//
+//  threadpool.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "constants.h"
+#include "threadpool.h"
+
+struct ThreadPool {
+    int numThreads;
+    pthread_t* threads;
+    pthread_mutex_t lock;
+    pthread_cond_t workReady;
+    pthread_cond_t workDone;
+    int generation;
+    int activeWorkers;
+    int isShuttingDown;
+
+    //The job currently being run by parallelFor.
+    ParallelTask task;
+    void* data;
+    int count;
+    int grainSize;
+    atomic_int nextIndex;
+};
+
+static void runChunks(struct ThreadPool* pool) {
+    for(;;) {
+        int begin = atomic_fetch_add(&pool->nextIndex, pool->grainSize);
+        if(begin >= pool->count) {
+            break;
+        }
+        int end = begin + pool->grainSize < pool->count ? begin + pool->grainSize : pool->count;
+        pool->task(pool->data, begin, end);
+    }
+}
+
+static void* workerMain(void* arg) {
+    struct ThreadPool* pool = (struct ThreadPool*) arg;
+    int seenGeneration = 0;
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        while(pool->generation == seenGeneration && !pool->isShuttingDown) {
+            pthread_cond_wait(&pool->workReady, &pool->lock);
+        }
+        if(pool->isShuttingDown) {
+            break;
+        }
+        seenGeneration = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        runChunks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->activeWorkers == 0) {
+            pthread_cond_signal(&pool->workDone);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+struct ThreadPool* createThreadPool(int numThreads) {
+    if(numThreads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = cpus > 0 ? (int)cpus : 1;
+    }
+    struct ThreadPool* pool = (struct ThreadPool*) calloc(1, sizeof(struct ThreadPool));
+    if(!pool) {
+        return NULL;
+    }
+    //The caller runs chunks too, so only numThreads - 1 workers are started.
+    pool->threads = (pthread_t*) malloc(sizeof(pthread_t) * (size_t)numThreads);
+    if(!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pool->numThreads = numThreads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workReady, NULL);
+    pthread_cond_init(&pool->workDone, NULL);
+    for(int i = 0; i < numThreads - 1; i++) {
+        if(pthread_create(&pool->threads[i], NULL, workerMain, pool) != 0) {
+            pool->numThreads = i + 1;
+            break;
+        }
+    }
+    return pool;
+}
+
+void destroyThreadPool(struct ThreadPool* pool) {
+    if(!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->isShuttingDown = TRUE;
+    pthread_cond_broadcast(&pool->workReady);
+    pthread_mutex_unlock(&pool->lock);
+    for(int i = 0; i < pool->numThreads - 1; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->workDone);
+    pthread_cond_destroy(&pool->workReady);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+int threadPoolSize(const struct ThreadPool* pool) {
+    return pool ? pool->numThreads : 1;
+}
+
+void parallelFor(struct ThreadPool* pool, int count, int grainSize, ParallelTask task, void* data) {
+    if(count <= 0) {
+        return;
+    }
+    grainSize = grainSize > 0 ? grainSize : 1;
+    if(!pool || pool->numThreads == 1 || count <= grainSize) {
+        task(data, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->data = data;
+    pool->count = count;
+    pool->grainSize = grainSize;
+    atomic_store(&pool->nextIndex, 0);
+    pool->activeWorkers = pool->numThreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->workReady);
+    pthread_mutex_unlock(&pool->lock);
+
+    runChunks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->activeWorkers > 0) {
+        pthread_cond_wait(&pool->workDone, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
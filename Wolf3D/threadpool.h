@@ -0,0 +1,26 @@
+//
+//  threadpool.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 8/30/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef threadpool_h
+#define threadpool_h
+
+//Called with a half-open range [begin, end) of task indices.
+typedef void (*ParallelTask)(void* data, int begin, int end);
+
+struct ThreadPool;
+
+//numThreads <= 0 uses one thread per online CPU. The calling thread counts as one of them.
+struct ThreadPool* createThreadPool(int numThreads);
+void destroyThreadPool(struct ThreadPool* pool);
+int threadPoolSize(const struct ThreadPool* pool);
+
+//Runs task over [0, count) in chunks of grainSize and returns once every chunk is done.
+//Workers grab chunks from a shared counter, so uneven chunks balance themselves.
+void parallelFor(struct ThreadPool* pool, int count, int grainSize, ParallelTask task, void* data);
+
+#endif /* threadpool_h */
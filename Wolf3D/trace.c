@@ -0,0 +1,166 @@
+//
+//  trace.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/3/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <math.h>
+#include "trace.h"
+
+//Queries handed to a worker at a time.
+#define TRACE_GRAIN_SIZE 256
+//Queries set up together. The setup is straight-line math over plain arrays, so the
+//compiler runs it across several queries per instruction; only the walks are serial.
+#define TRACE_BLOCK_SIZE 64
+
+//Where each query starts on the grid and how far along the ray the grid lines are.
+struct TraceBlock {
+    int col[TRACE_BLOCK_SIZE];
+    int row[TRACE_BLOCK_SIZE];
+    int stepCol[TRACE_BLOCK_SIZE];
+    int stepRow[TRACE_BLOCK_SIZE];
+    //In multiples of the query's direction vector, which needn't be a unit vector.
+    float deltaX[TRACE_BLOCK_SIZE];     //Between consecutive vertical grid lines
+    float deltaY[TRACE_BLOCK_SIZE];
+    float nextX[TRACE_BLOCK_SIZE];      //To the next vertical grid line
+    float nextY[TRACE_BLOCK_SIZE];
+};
+
+struct TraceJob {
+    const struct World* world;
+    const struct TraceQueries* queries;
+    struct TraceResults* results;
+};
+
+//Every value is computed and then selected, without branches or library calls, so a
+//loop of these vectorizes. Distances stay in direction lengths here; the walk converts them.
+static inline void setupTrace(struct TraceBlock* block, int i, float originX, float originY,
+                              float directionX, float directionY) {
+    float x = originX / TILE_SIZE;
+    float y = originY / TILE_SIZE;
+    int col = (int)x;
+    int row = (int)y;
+    col -= x < col;
+    row -= y < row;
+    //The grid line the ray crosses first: the cell's right edge when heading right, its left edge otherwise.
+    float lineX = (float)col * TILE_SIZE + (directionX > 0 ? TILE_SIZE : 0);
+    float lineY = (float)row * TILE_SIZE + (directionY > 0 ? TILE_SIZE : 0);
+    float nextX = (lineX - originX) / directionX;
+    float nextY = (lineY - originY) / directionY;
+    block->col[i] = col;
+    block->row[i] = row;
+    block->stepCol[i] = directionX > 0 ? 1 : -1;
+    block->stepRow[i] = directionY > 0 ? 1 : -1;
+    block->deltaX[i] = TILE_SIZE / fabsf(directionX);
+    block->deltaY[i] = TILE_SIZE / fabsf(directionY);
+    block->nextX[i] = directionX != 0 ? nextX : INFINITY;
+    block->nextY[i] = directionY != 0 ? nextY : INFINITY;
+}
+
+static int walkGrid(const int* map, int numCols, int numRows, const struct TraceBlock* block, int i,
+                    float directionX, float directionY, float maxDistance, struct TraceHit* hit) {
+    int col = block->col[i];
+    int row = block->row[i];
+    if(col < 0 || col >= numCols || row < 0 || row >= numRows || map[row * numCols + col] != 0) {
+        hit->cell = col < 0 || col >= numCols || row < 0 || row >= numRows ? -1 : row * numCols + col;
+        hit->distance = 0;
+        hit->side = TRACE_HIT_INSIDE;
+        return TRUE;
+    }
+    hit->cell = -1;
+    hit->distance = maxDistance;
+    hit->side = TRACE_MISS;
+    float length = sqrtf(directionX * directionX + directionY * directionY);
+    if(length == 0) {
+        return FALSE;
+    }
+    float maxSteps = maxDistance / length;
+    int stepCol = block->stepCol[i];
+    int stepRow = block->stepRow[i];
+    float deltaX = block->deltaX[i];
+    float deltaY = block->deltaY[i];
+    float nextX = block->nextX[i];
+    float nextY = block->nextY[i];
+    for(;;) {
+        float steps;
+        int side;
+        if(nextX < nextY) {
+            steps = nextX;
+            col += stepCol;
+            nextX += deltaX;
+            side = TRACE_HIT_VERTICAL;
+        }
+        else {
+            steps = nextY;
+            row += stepRow;
+            nextY += deltaY;
+            side = TRACE_HIT_HORIZONTAL;
+        }
+        if(steps > maxSteps) {
+            return FALSE;
+        }
+        int isOutside = col < 0 || col >= numCols || row < 0 || row >= numRows;
+        if(isOutside || map[row * numCols + col] != 0) {
+            hit->cell = isOutside ? -1 : row * numCols + col;
+            hit->distance = steps * length;
+            hit->side = side;
+            return TRUE;
+        }
+    }
+}
+
+int traceRay(const int* map, int numCols, int numRows, float originX, float originY,
+             float directionX, float directionY, float maxDistance, struct TraceHit* hit) {
+    struct TraceBlock block;
+    setupTrace(&block, 0, originX, originY, directionX, directionY);
+    return walkGrid(map, numCols, numRows, &block, 0, directionX, directionY, maxDistance, hit);
+}
+
+static void traceRange(void* data, int begin, int end) {
+    struct TraceJob* job = (struct TraceJob*) data;
+    const struct World* world = job->world;
+    const struct TraceQueries* queries = job->queries;
+    struct TraceResults* results = job->results;
+    struct TraceBlock block;
+    for(int first = begin; first < end; first += TRACE_BLOCK_SIZE) {
+        const float* originX = &queries->originX[first];
+        const float* originY = &queries->originY[first];
+        const float* directionX = &queries->directionX[first];
+        const float* directionY = &queries->directionY[first];
+        int count = end - first < TRACE_BLOCK_SIZE ? end - first : TRACE_BLOCK_SIZE;
+        if(count == TRACE_BLOCK_SIZE) {
+            //A constant trip count lets the compiler vectorize this even with its cheapest cost model.
+            for(int i = 0; i < TRACE_BLOCK_SIZE; i++) {
+                setupTrace(&block, i, originX[i], originY[i], directionX[i], directionY[i]);
+            }
+        }
+        else {
+            for(int i = 0; i < count; i++) {
+                setupTrace(&block, i, originX[i], originY[i], directionX[i], directionY[i]);
+            }
+        }
+        for(int i = 0; i < count; i++) {
+            struct TraceHit hit;
+            walkGrid(world->map, world->numCols, world->numRows, &block, i, directionX[i], directionY[i],
+                     queries->maxDistance[first + i], &hit);
+            results->cell[first + i] = hit.cell;
+            results->distance[first + i] = hit.distance;
+            results->side[first + i] = (uint8_t)hit.side;
+        }
+    }
+}
+
+void traceBatch(const struct World* world, const struct TraceQueries* queries, struct TraceResults* results,
+                struct ThreadPool* pool) {
+    struct TraceJob job = { world, queries, results };
+    parallelFor(pool, queries->count, TRACE_GRAIN_SIZE, traceRange, &job);
+}
+
+int hasLineOfSight(const struct World* world, float x0, float y0, float x1, float y1) {
+    struct TraceHit hit;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    return !traceRay(world->map, world->numCols, world->numRows, x0, y0, dx, dy, sqrtf(dx * dx + dy * dy), &hit);
+}
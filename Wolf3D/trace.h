@@ -0,0 +1,58 @@
+//
+//  trace.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/3/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef trace_h
+#define trace_h
+
+#include <stdint.h>
+#include "engine.h"
+#include "threadpool.h"
+
+enum TraceSide {
+    TRACE_MISS,             //Nothing within maxDistance
+    TRACE_HIT_VERTICAL,     //Entered the wall through its left or right side
+    TRACE_HIT_HORIZONTAL,   //Entered the wall through its top or bottom
+    TRACE_HIT_INSIDE        //Started inside a wall or outside the map
+};
+
+struct TraceHit {
+    int cell;       //row * numCols + col of the wall, -1 for a miss or for leaving the map
+    float distance; //Along the ray to where it entered the cell; maxDistance on a miss
+    int side;       //enum TraceSide
+};
+
+//count queries as parallel arrays. Directions needn't be normalized.
+struct TraceQueries {
+    int count;
+    const float* originX;
+    const float* originY;
+    const float* directionX;
+    const float* directionY;
+    const float* maxDistance;
+};
+
+//One array per result field, each with room for the query count.
+struct TraceResults {
+    int* cell;
+    float* distance;
+    uint8_t* side;
+};
+
+//Walks the grid cell by cell from the origin until it enters a wall, leaves the map
+//or passes maxDistance. Only reads the map, so any number of threads can trace at once.
+int traceRay(const int* map, int numCols, int numRows, float originX, float originY,
+             float directionX, float directionY, float maxDistance, struct TraceHit* hit);
+
+//Runs every query, split across the pool's threads; pool may be NULL.
+void traceBatch(const struct World* world, const struct TraceQueries* queries, struct TraceResults* results,
+                struct ThreadPool* pool);
+
+//TRUE if nothing blocks the straight line between the two points.
+int hasLineOfSight(const struct World* world, float x0, float y0, float x1, float y1);
+
+#endif /* trace_h */
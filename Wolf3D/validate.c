@@ -0,0 +1,520 @@
+//
+//  validate.c
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/1/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "validate.h"
+#include "mapgen.h"
+#include "pvs.h"
+#include "trace.h"
+#include "entities.h"
+
+//Same floating-point rules as kernels.c, so agreement can be exact.
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#define VALIDATION_WIDTH 320
+#define VALIDATION_HEIGHT 200
+#define MAX_KERNEL_SETS (2 * NUM_KERNEL_ISAS)
+#define NUM_PROBE_ANGLES 8
+#define MAX_REPORTED_FAILURES 5
+//Filling and checking a frame costs far more than casting its rays, so only every
+//this many poses is shaded. Rays are checked for every pose.
+#define FRAME_CHECK_INTERVAL 16
+//Targets are picked this many tiles past the PVS window along either axis, so some
+//pairs test the seesPastWindow answer.
+#define PVS_TARGET_MARGIN 8
+//Entities spawned for the sight check, each checked from every player position.
+#define VALIDATION_ENTITIES 1000
+
+//Distances may differ by this fraction of the reference distance.
+#define DISTANCE_TOLERANCE 1e-4f
+//Texels may come from this many rows above or below the reference row, since the
+//kernels step in fixed point where the reference multiplies in float.
+#define TEXEL_ROW_TOLERANCE 1
+
+struct ValidationReport {
+    long raysChecked;
+    long distanceErrors;
+    float maxDistanceError;
+    long hitMismatches;     //Different wall content or side
+    long pixelsChecked;
+    long texelsOffByRow;    //Tolerated
+    long pixelErrors;
+    int failuresReported;
+};
+
+struct KernelSet {
+    struct RenderKernels kernels;
+    struct ValidationReport report;
+};
+
+////////////////////////////////////////////////////////////
+// REFERENCE: castRay() and generate3DProjection() as first
+// written, with the world bounds taken from the map size.
+////////////////////////////////////////////////////////////
+
+static float normalizeAngle(float angle) {
+    angle = remainderf(angle, TWO_PI);
+    if(angle < 0) {
+        angle += TWO_PI;
+    }
+    return angle;
+}
+
+static float distanceBetweenPoints(float x1, float y1, float x2, float y2) {
+    return sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
+}
+
+static int referenceTileAt(const struct World* world, float x, float y) {
+    int _x = floor(x/TILE_SIZE);
+    int _y = floor(y/TILE_SIZE);
+    //The right and bottom edges themselves belong to the last tile.
+    _x = _x >= world->numCols ? world->numCols - 1 : _x;
+    _y = _y >= world->numRows ? world->numRows - 1 : _y;
+    return world->map[_y * world->numCols + _x];
+}
+
+static int referenceHasWallAt(const struct World* world, float x, float y) {
+    if(x < 0 || x > world->numCols * TILE_SIZE || y < 0 || y > world->numRows * TILE_SIZE) {
+        return TRUE;
+    }
+    return referenceTileAt(world, x, y) != 0;
+}
+
+static void referenceCastRay(const struct World* world, float originX, float originY, float rayAngle, struct Ray* ray) {
+    float worldWidth = world->numCols * TILE_SIZE;
+    float worldHeight = world->numRows * TILE_SIZE;
+    rayAngle = normalizeAngle(rayAngle);
+
+    int isRayFacingDown = rayAngle > 0 && rayAngle < PI;
+    int isRayFacingUp = !isRayFacingDown;
+
+    int isRayFacingRight = rayAngle < 0.5 * PI || rayAngle > 1.5 * PI;
+    int isRayFacingLeft = !isRayFacingRight;
+
+    float xintercept, yintercept;
+    float xstep, ystep;
+
+    // Horizontal grid intersections
+    int foundHorzWallHit = FALSE;
+    float horzWallHitX = 0;
+    float horzWallHitY = 0;
+    int horzWallContent = 0;
+
+    yintercept = floor(originY / TILE_SIZE) * TILE_SIZE;
+    yintercept += isRayFacingDown ? TILE_SIZE : 0;
+    xintercept = originX + (yintercept - originY) / tan(rayAngle);
+
+    ystep = TILE_SIZE;
+    ystep *= isRayFacingUp ? -1 : 1;
+    xstep = TILE_SIZE / tan(rayAngle);
+    xstep *= (isRayFacingLeft && xstep > 0) ? -1 : 1;
+    xstep *= (isRayFacingRight && xstep < 0) ? -1 : 1;
+
+    float nextHorzTouchX = xintercept;
+    float nextHorzTouchY = yintercept;
+    while (nextHorzTouchX >= 0 && nextHorzTouchX <= worldWidth && nextHorzTouchY >= 0 && nextHorzTouchY <= worldHeight) {
+        float xToCheck = nextHorzTouchX;
+        float yToCheck = nextHorzTouchY + (isRayFacingUp ? -1 : 0);
+        if (referenceHasWallAt(world, xToCheck, yToCheck)) {
+            horzWallHitX = nextHorzTouchX;
+            horzWallHitY = nextHorzTouchY;
+            horzWallContent = referenceTileAt(world, xToCheck, yToCheck);
+            foundHorzWallHit = TRUE;
+            break;
+        } else {
+            nextHorzTouchX += xstep;
+            nextHorzTouchY += ystep;
+        }
+    }
+
+    // Vertical grid intersections
+    int foundVertWallHit = FALSE;
+    float vertWallHitX = 0;
+    float vertWallHitY = 0;
+    int vertWallContent = 0;
+
+    xintercept = floor(originX / TILE_SIZE) * TILE_SIZE;
+    xintercept += isRayFacingRight ? TILE_SIZE : 0;
+    yintercept = originY + (xintercept - originX) * tan(rayAngle);
+
+    xstep = TILE_SIZE;
+    xstep *= isRayFacingLeft ? -1 : 1;
+    ystep = TILE_SIZE * tan(rayAngle);
+    ystep *= (isRayFacingUp && ystep > 0) ? -1 : 1;
+    ystep *= (isRayFacingDown && ystep < 0) ? -1 : 1;
+
+    float nextVertTouchX = xintercept;
+    float nextVertTouchY = yintercept;
+    while (nextVertTouchX >= 0 && nextVertTouchX <= worldWidth && nextVertTouchY >= 0 && nextVertTouchY <= worldHeight) {
+        float xToCheck = nextVertTouchX + (isRayFacingLeft ? -1 : 0);
+        float yToCheck = nextVertTouchY;
+        if (referenceHasWallAt(world, xToCheck, yToCheck)) {
+            vertWallHitX = nextVertTouchX;
+            vertWallHitY = nextVertTouchY;
+            vertWallContent = referenceTileAt(world, xToCheck, yToCheck);
+            foundVertWallHit = TRUE;
+            break;
+        } else {
+            nextVertTouchX += xstep;
+            nextVertTouchY += ystep;
+        }
+    }
+
+    float horzHitDistance = foundHorzWallHit
+    ? distanceBetweenPoints(originX, originY, horzWallHitX, horzWallHitY)
+    : INT_MAX;
+    float vertHitDistance = foundVertWallHit
+    ? distanceBetweenPoints(originX, originY, vertWallHitX, vertWallHitY)
+    : INT_MAX;
+
+    if (vertHitDistance < horzHitDistance) {
+        ray->distance = vertHitDistance;
+        ray->wallHitX = vertWallHitX;
+        ray->wallHitY = vertWallHitY;
+        ray->wallHitContent = vertWallContent;
+        ray->wasHitVertical = TRUE;
+    } else {
+        ray->distance = horzHitDistance;
+        ray->wallHitX = horzWallHitX;
+        ray->wallHitY = horzWallHitY;
+        ray->wallHitContent = horzWallContent;
+        ray->wasHitVertical = FALSE;
+    }
+    ray->rayAngle = rayAngle;
+    ray->isRayFacingDown = isRayFacingDown;
+    ray->isRayFacingUp = isRayFacingUp;
+    ray->isRayFacingLeft = isRayFacingLeft;
+    ray->isRayFacingRight = isRayFacingRight;
+}
+
+//Wall span and texel for one column, computed per pixel in float.
+struct ReferenceColumn {
+    int wallStripHeight;
+    int wallTopPixel;
+    int wallBottomPixel;
+    int textureOffsetX;
+    const uint32_t* texture;
+};
+
+static void referenceProjectColumn(const struct World* world, const struct Ray* ray, float cameraAngle, struct ReferenceColumn* column) {
+    float distanceProjPlane = (VALIDATION_WIDTH) / 2 / tan(FOV_ANGLE/2);
+    float perpDistance = ray->distance * cos(ray->rayAngle - cameraAngle);
+    float projectedWallHeight = (TILE_SIZE/perpDistance) * distanceProjPlane;
+    column->wallStripHeight = projectedWallHeight < MAX_WALL_STRIP_HEIGHT ? (int) projectedWallHeight : MAX_WALL_STRIP_HEIGHT;
+
+    int wallTopPixel = (VALIDATION_HEIGHT/2) - (column->wallStripHeight/2);
+    column->wallTopPixel = wallTopPixel < 0 ? 0 : wallTopPixel;
+    int wallBottomPixel = (VALIDATION_HEIGHT/2) + (column->wallStripHeight/2);
+    column->wallBottomPixel = wallBottomPixel > VALIDATION_HEIGHT ? VALIDATION_HEIGHT : wallBottomPixel;
+
+    int wallHit = (int)(ray->wasHitVertical ? ray->wallHitY : ray->wallHitX);
+    column->textureOffsetX = (wallHit % TILE_SIZE) * TEXTURE_WIDTH / TILE_SIZE;
+    column->texture = world->textures[ray->wallHitContent-1];
+}
+
+static int referenceTextureRow(const struct ReferenceColumn* column, int y) {
+    int distanceFromTop = (y + (column->wallStripHeight/2) - (VALIDATION_HEIGHT/2));
+    int textureOffsetY = distanceFromTop * ((float)TEXTURE_HEIGHT/column->wallStripHeight);
+    return textureOffsetY < 0 ? 0 : (textureOffsetY >= TEXTURE_HEIGHT ? TEXTURE_HEIGHT - 1 : textureOffsetY);
+}
+
+////////////////////////////////////////////////////////////
+// COMPARISON
+////////////////////////////////////////////////////////////
+
+static void compareRay(struct ValidationReport* report, const char* name, const struct Ray* expected, const struct Ray* actual,
+                       float x, float y) {
+    report->raysChecked++;
+    float error = fabsf(expected->distance - actual->distance);
+    float relativeError = error / (expected->distance > 1 ? expected->distance : 1);
+    int isDistanceError = !(relativeError <= DISTANCE_TOLERANCE);
+    int isHitMismatch = expected->wallHitContent != actual->wallHitContent || expected->wasHitVertical != actual->wasHitVertical;
+    if(relativeError > report->maxDistanceError) {
+        report->maxDistanceError = relativeError;
+    }
+    report->distanceErrors += isDistanceError;
+    report->hitMismatches += isHitMismatch;
+    if((isDistanceError || isHitMismatch) && report->failuresReported < MAX_REPORTED_FAILURES) {
+        report->failuresReported++;
+        printf("  %s: ray from (%.9g, %.9g) at %.9g: distance %.9g vs %.9g, content %d vs %d, %s vs %s \n",
+               name, x, y, expected->rayAngle, expected->distance, actual->distance,
+               expected->wallHitContent, actual->wallHitContent,
+               expected->wasHitVertical ? "vertical" : "horizontal", actual->wasHitVertical ? "vertical" : "horizontal");
+    }
+}
+
+static void compareFrame(const struct World* world, struct ValidationReport* report, const struct Ray* expectedRays,
+                         float cameraAngle, const uint32_t* frame) {
+    for(int i = 0; i < VALIDATION_WIDTH; i++) {
+        struct ReferenceColumn column;
+        referenceProjectColumn(world, &expectedRays[i], cameraAngle, &column);
+        for(int y = 0; y < VALIDATION_HEIGHT; y++) {
+            uint32_t actual = frame[y * VALIDATION_WIDTH + i];
+            report->pixelsChecked++;
+            if(y < column.wallTopPixel || y >= column.wallBottomPixel) {
+                report->pixelErrors += actual != (y < column.wallTopPixel ? CEILING_COLOR : FLOOR_COLOR);
+                continue;
+            }
+            int row = referenceTextureRow(&column, y);
+            if(actual == column.texture[row * TEXTURE_WIDTH + column.textureOffsetX]) {
+                continue;
+            }
+            int isNearby = FALSE;
+            for(int d = -TEXEL_ROW_TOLERANCE; d <= TEXEL_ROW_TOLERANCE && !isNearby; d++) {
+                int nearbyRow = row + d;
+                isNearby = nearbyRow >= 0 && nearbyRow < TEXTURE_HEIGHT
+                && actual == column.texture[nearbyRow * TEXTURE_WIDTH + column.textureOffsetX];
+            }
+            if(isNearby) {
+                report->texelsOffByRow++;
+            }
+            else {
+                report->pixelErrors++;
+            }
+        }
+    }
+}
+
+//Shades the reference rays, so the pixel checks measure the fill alone, in 32-bit
+//and, if the world has indexed textures, in 8-bit.
+static void checkFrames(const struct World* world, const struct RenderKernels* k, struct ValidationReport* report,
+                        const struct Ray* expectedRays, float cameraAngle, uint32_t* frame, uint8_t* indexedFrame) {
+    k->drawWalls(expectedRays, VALIDATION_WIDTH, cameraAngle, frame, VALIDATION_WIDTH, VALIDATION_HEIGHT,
+                 world->textures, NULL);
+    compareFrame(world, report, expectedRays, cameraAngle, frame);
+    if(world->indexedTextures[0]) {
+        k->drawIndexedWalls(expectedRays, VALIDATION_WIDTH, cameraAngle, indexedFrame, VALIDATION_WIDTH, VALIDATION_HEIGHT,
+                            (const uint8_t* const*) world->indexedTextures, NULL);
+        k->expandPalette(frame, indexedFrame, world->palette, VALIDATION_WIDTH * VALIDATION_HEIGHT);
+        compareFrame(world, report, expectedRays, cameraAngle, frame);
+    }
+}
+
+//Random points anywhere in a tile, or pinned to its edges and corners.
+static void pickPointInTile(uint32_t* state, int col, int row, int kind, float* x, float* y) {
+    *x = (col + nextRandomFloat(state)) * TILE_SIZE;
+    *y = (row + nextRandomFloat(state)) * TILE_SIZE;
+    if(kind == 1 || kind == 3) {
+        *x = (col + (nextRandom(state) & 1)) * TILE_SIZE;
+    }
+    if(kind == 2 || kind == 3) {
+        *y = (row + (nextRandom(state) & 1)) * TILE_SIZE;
+    }
+}
+
+static int pickEmptyTile(const struct World* world, uint32_t* state) {
+    int tile;
+    do {
+        tile = (int)(nextRandom(state) % (uint32_t)(world->numCols * world->numRows));
+    } while(world->map[tile] != 0);
+    return tile;
+}
+
+static void pickPose(const struct World* world, uint32_t* state, int poseIndex, float* x, float* y, float* angle) {
+    int tile = pickEmptyTile(world, state);
+    int kind = poseIndex % 4;
+    pickPointInTile(state, tile % world->numCols, tile / world->numCols, kind, x, y);
+    *angle = nextRandomFloat(state) * TWO_PI;
+    if(kind != 0 && (nextRandom(state) & 1)) {
+        *angle = (nextRandom(state) % NUM_PROBE_ANGLES) * (PI / 4);
+    }
+}
+
+int validateKernels(const struct World* world, int numPoses, uint32_t seed) {
+    struct KernelSet sets[MAX_KERNEL_SETS];
+    int numSets = 0;
+    for(int isa = 0; isa < NUM_KERNEL_ISAS; isa++) {
+        if(loadRenderKernels((enum KernelIsa)isa, &sets[numSets].kernels)) {
+            numSets++;
+        }
+        if(loadGenericRenderKernels((enum KernelIsa)isa, &sets[numSets].kernels)
+           && sets[numSets].kernels.castRays != sets[numSets - 1].kernels.castRays) {
+            numSets++;
+        }
+    }
+
+    struct Ray* expectedRays = (struct Ray*) malloc(sizeof(struct Ray) * VALIDATION_WIDTH);
+    struct Ray* actualRays = (struct Ray*) malloc(sizeof(struct Ray) * VALIDATION_WIDTH);
+    uint32_t* frame = (uint32_t*) malloc(sizeof(uint32_t) * VALIDATION_WIDTH * VALIDATION_HEIGHT);
+    uint8_t* indexedFrame = (uint8_t*) malloc(sizeof(uint8_t) * VALIDATION_WIDTH * VALIDATION_HEIGHT);
+    if(!expectedRays || !actualRays || !frame || !indexedFrame) {
+        free(expectedRays);
+        free(actualRays);
+        free(frame);
+        free(indexedFrame);
+        return FALSE;
+    }
+    for(int s = 0; s < numSets; s++) {
+        struct ValidationReport empty = { 0 };
+        sets[s].report = empty;
+    }
+
+    uint32_t state = seed ? seed : 1;
+    float angleStep = FOV_ANGLE / VALIDATION_WIDTH;
+    for(int pose = 0; pose < numPoses; pose++) {
+        float x, y, cameraAngle;
+        pickPose(world, &state, pose, &x, &y, &cameraAngle);
+
+        float rayAngle = cameraAngle - (FOV_ANGLE/2);
+        for(int i = 0; i < VALIDATION_WIDTH; i++) {
+            referenceCastRay(world, x, y, rayAngle, &expectedRays[i]);
+            rayAngle += angleStep;
+        }
+
+        for(int s = 0; s < numSets; s++) {
+            const struct RenderKernels* k = &sets[s].kernels;
+            struct ValidationReport* report = &sets[s].report;
+            k->castRays(world->map, world->numCols, world->numRows, x, y, cameraAngle - (FOV_ANGLE/2), angleStep,
+                        actualRays, VALIDATION_WIDTH);
+            for(int i = 0; i < VALIDATION_WIDTH; i++) {
+                compareRay(report, k->name, &expectedRays[i], &actualRays[i], x, y);
+            }
+            if(pose % FRAME_CHECK_INTERVAL == 0) {
+                checkFrames(world, k, report, expectedRays, cameraAngle, frame, indexedFrame);
+            }
+
+            //Exact axis and diagonal rays are where grid stepping is most fragile.
+            if(pose % 4 != 0) {
+                for(int a = 0; a < NUM_PROBE_ANGLES; a++) {
+                    struct Ray expected, actual;
+                    referenceCastRay(world, x, y, a * (PI / 4), &expected);
+                    k->castRays(world->map, world->numCols, world->numRows, x, y, a * (PI / 4), 0, &actual, 1);
+                    compareRay(report, k->name, &expected, &actual, x, y);
+                }
+            }
+        }
+    }
+
+    int isValid = TRUE;
+    for(int s = 0; s < numSets; s++) {
+        const struct ValidationReport* report = &sets[s].report;
+        int isSetValid = report->distanceErrors == 0 && report->hitMismatches == 0 && report->pixelErrors == 0;
+        isValid = isValid && isSetValid;
+        printf("%-7s %-26s %s: %ld rays, %ld distance errors (max %.2g), %ld hit mismatches; %ld pixels, %ld off by a texel row, %ld errors \n",
+               sets[s].kernels.name, sets[s].kernels.variant, isSetValid ? "ok  " : "FAIL",
+               report->raysChecked, report->distanceErrors, report->maxDistanceError, report->hitMismatches,
+               report->pixelsChecked, report->texelsOffByRow, report->pixelErrors);
+    }
+    free(expectedRays);
+    free(actualRays);
+    free(frame);
+    free(indexedFrame);
+    return isValid;
+}
+
+//Random pairs of points with a trace either way between them must never be hidden.
+static int checkPvsPairs(const struct World* world, const struct Pvs* pvs, struct PvsView* view, int numPairs,
+                         uint32_t* state) {
+    long clearPairs = 0;
+    long blockedPairs = 0;
+    long culledPairs = 0;
+    long missedPairs = 0;
+    int reach = PVS_MAX_DISTANCE + PVS_TARGET_MARGIN;
+    for(int pair = 0; pair < numPairs; pair++) {
+        int tile = pickEmptyTile(world, state);
+        int col = tile % world->numCols;
+        int row = tile / world->numCols;
+        float x0, y0, x1, y1;
+        pickPointInTile(state, col, row, pair % 4, &x0, &y0);
+        //Half the targets are close by, where most sight lines are decided.
+        int range = pair % 2 ? reach : PVS_MAX_DISTANCE / 4;
+        int targetCol, targetRow;
+        do {
+            targetCol = col + (int)(nextRandom(state) % (uint32_t)(2 * range + 1)) - range;
+            targetRow = row + (int)(nextRandom(state) % (uint32_t)(2 * range + 1)) - range;
+        } while(targetCol < 0 || targetCol >= world->numCols || targetRow < 0 || targetRow >= world->numRows
+                || world->map[targetRow * world->numCols + targetCol] != 0);
+        pickPointInTile(state, targetCol, targetRow, (pair / 4) % 4, &x1, &y1);
+
+        loadPvsView(pvs, x0, y0, view);
+        int isClear = hasLineOfSight(world, x0, y0, x1, y1) || hasLineOfSight(world, x1, y1, x0, y0);
+        int isPotentiallyVisible = pvsViewCanSee(view, x1, y1);
+        clearPairs += isClear;
+        blockedPairs += !isClear;
+        culledPairs += !isClear && !isPotentiallyVisible;
+        if(isClear && !isPotentiallyVisible) {
+            if(missedPairs < MAX_REPORTED_FAILURES) {
+                printf("  PVS hides (%.9g, %.9g) from (%.9g, %.9g), which a trace reaches \n", x1, y1, x0, y0);
+            }
+            missedPairs++;
+        }
+    }
+    printf("PVS     %s: %d pairs, %ld clear, %ld of them hidden; %ld of %ld blocked pairs culled, %zu KB \n",
+           missedPairs == 0 ? "ok  " : "FAIL", numPairs, clearPairs, missedPairs, culledPairs, blockedPairs,
+           pvsMemoryUsage(pvs) / 1024);
+    return missedPairs == 0;
+}
+
+//checkEntitySight() with the PVS must agree with tracing every entity.
+static int checkSightOfEntities(const struct World* world, const struct Pvs* pvs, struct PvsView* view, int numViews,
+                                uint32_t* state) {
+    struct EntityStore store;
+    if(!createEntityStore(&store, world, VALIDATION_ENTITIES)) {
+        return FALSE;
+    }
+    spawnEntities(&store, world, VALIDATION_ENTITIES, *state);
+    long checks = 0;
+    long visible = 0;
+    long culled = 0;
+    long errors = 0;
+    for(int v = 0; v < numViews; v++) {
+        int tile = pickEmptyTile(world, state);
+        float x, y;
+        pickPointInTile(state, tile % world->numCols, tile / world->numCols, v % 4, &x, &y);
+        loadPvsView(pvs, x, y, view);
+        checkEntitySight(&store, world, view, x, y, NULL);
+        for(int i = 0; i < store.count; i++) {
+            //Entities trace toward the target, so the reference does too.
+            int isClear = hasLineOfSight(world, store.x[i], store.y[i], x, y);
+            checks++;
+            visible += isClear;
+            culled += !pvsViewCanSee(view, store.x[i], store.y[i]);
+            if(store.canSeeTarget[i] != isClear) {
+                if(errors < MAX_REPORTED_FAILURES) {
+                    printf("  entity at (%.9g, %.9g) %s (%.9g, %.9g), the trace says otherwise \n",
+                           store.x[i], store.y[i], isClear ? "doesn't see" : "sees", x, y);
+                }
+                errors++;
+            }
+        }
+    }
+    printf("Sight   %s: %ld entity checks, %ld visible, %ld wrong; %ld traces skipped \n",
+           errors == 0 ? "ok  " : "FAIL", checks, visible, errors, culled);
+    destroyEntityStore(&store);
+    return errors == 0;
+}
+
+int validatePvs(const struct World* world, int numPairs, uint32_t seed) {
+    struct Pvs* pvs = (struct Pvs*) malloc(sizeof(struct Pvs));
+    if(!pvs || !createPvs(pvs, world->map, world->numCols, world->numRows)) {
+        free(pvs);
+        return FALSE;
+    }
+    while(!updatePvs(pvs, 1000)) {
+    }
+    struct PvsView* view = (struct PvsView*) malloc(sizeof(struct PvsView));
+    if(!view) {
+        destroyPvs(pvs);
+        free(pvs);
+        return FALSE;
+    }
+    uint32_t state = seed ? seed : 1;
+    int isValid = checkPvsPairs(world, pvs, view, numPairs, &state);
+    isValid = checkSightOfEntities(world, pvs, view, numPairs / VALIDATION_ENTITIES + 1, &state) && isValid;
+    free(view);
+    destroyPvs(pvs);
+    free(pvs);
+    return isValid;
+}
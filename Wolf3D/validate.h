@@ -0,0 +1,29 @@
+//
+//  validate.h
+//  Wolf3D
+//
+//  Created by Chaitanya Kochhar on 9/1/20.
+//  Copyright © 2020 Chaitanya Kochhar. All rights reserved.
+//
+
+#ifndef validate_h
+#define validate_h
+
+#include <stdint.h>
+#include "engine.h"
+
+//Renders numPoses seeded poses over the world with a straightforward reference
+//castRay()/generate3DProjection() and with every kernel set the host can run, both
+//size-specialized and generic, and reports how far each strays from the reference.
+//A quarter of the poses are random; the rest sit exactly on grid lines or corners,
+//and those also cast single rays along the axes and diagonals.
+//Returns TRUE if every kernel set stayed within tolerance.
+int validateKernels(const struct World* world, int numPoses, uint32_t seed);
+
+//Builds the world's PVS and traces numPairs seeded pairs of points, some pinned to tile
+//edges, with hasLineOfSight(). The set must never hide a point the trace reaches either
+//way. Then checkEntitySight() with the PVS must agree with tracing every entity, from
+//one player position per VALIDATION_ENTITIES pairs. Returns TRUE if both held.
+int validatePvs(const struct World* world, int numPairs, uint32_t seed);
+
+#endif /* validate_h */